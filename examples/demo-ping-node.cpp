@@ -7,12 +7,11 @@
 #include "PingNode.hpp"
 
 // Insert your pin number(s) here
-const int trigPin = D1;  // GPIO 5
-const int echoPin = D2;  // GPIO 4
-const int relayPin = D5; // GPIO 16
-const int dhtPin = D7;   // GPIO 13
-;
-const int ledPin = LED_BUILTIN;
+const int trigPin = 5;   // =D1 on Wemos
+const int echoPin = 4;   // =D2 on Wemos
+const int relayPin = 14; // =D5 on Wemos
+const int dhtPin = 13;   // =D7 on Wemos
+const int ledPin = 2;    // =D4 on Wemos
 
 unsigned long TEMPERATURE_INTERVAL = 120; // seconds
 unsigned long lastTemperatureUpdate = 0;
@@ -4,7 +4,7 @@
 #include <Homie.hpp>
 #include "PulseNode.hpp"
 
-#define PIN_OPTOCOUPLER D7  // GPIO 13
+#define PIN_OPTOCOUPLER 13 // =D7 on Wemos
 
 PulseNode pulseNode("pulse", "Door bell", PIN_OPTOCOUPLER);
 
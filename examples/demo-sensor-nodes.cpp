@@ -17,7 +17,9 @@ const int PIN_DS18 = 16; // =D0 on Wemos
 
 const int I2C_BME280_ADDRESS = 0x77; // Default I2C address for BME280. can be changed to 0x76 by changing a solder bridge
 
+#ifdef ESP8266
 ADC_MODE(ADC_VCC); // Set ADC to measure internal VCC
+#endif
 
 // Create one node of each kind
 BME280Node bme280Node("bme280", "Outdoor", I2C_BME280_ADDRESS);
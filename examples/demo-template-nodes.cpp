@@ -0,0 +1,113 @@
+#define FW_NAME "demo-template-nodes"
+#define FW_VERSION "1.0.0"
+
+#include <Homie.h>
+
+#include "ContactNode.hpp"
+#include "ContactNodeT.hpp"
+#include "RelayNode.hpp"
+#include "RelayNodeT.hpp"
+
+// Insert your pin number(s) here
+const int PIN_LED = 2;       // =D4 on Wemos
+const int PIN_CONTACT = 12;  // =D6 on Wemos
+const int PIN_RELAY = 13;    // =D7 on Wemos
+const int PIN_CONTACT2 = 14; // =D5 on Wemos
+const int PIN_RELAY2 = 5;    // =D1 on Wemos
+
+const int BENCHMARK_RUNS = 100;
+
+// Expose the protected entry points that Homie calls. A set command goes through
+// handleInput(), the command parsing, the relay, the timeout and the publishing.
+// A loop() pass of a contact reads and debounces the pin.
+class BenchRelayNode : public RelayNode
+{
+public:
+  using RelayNode::RelayNode;
+  using RelayNode::handleInput;
+};
+
+template <int8_t RelayPin, int8_t LedPin>
+class BenchRelayNodeT : public RelayNodeT<RelayPin, LedPin>
+{
+public:
+  using RelayNodeT<RelayPin, LedPin>::RelayNodeT;
+  using RelayNodeT<RelayPin, LedPin>::handleInput;
+};
+
+class BenchContactNode : public ContactNode
+{
+public:
+  using ContactNode::ContactNode;
+  using ContactNode::loop;
+};
+
+template <int8_t ContactPin>
+class BenchContactNodeT : public ContactNodeT<ContactPin>
+{
+public:
+  using ContactNodeT<ContactPin>::ContactNodeT;
+  using ContactNodeT<ContactPin>::loop;
+};
+
+// The same relay and contact, configured at runtime and at compile time
+BenchRelayNode relay("relay", "Relay", PIN_RELAY, PIN_LED);
+BenchRelayNodeT<PIN_RELAY2, PIN_LED> relayT("relayt", "RelayT");
+BenchContactNode contact("contact", "Contact", PIN_CONTACT);
+BenchContactNodeT<PIN_CONTACT2> contactT("contactt", "ContactT");
+
+template <typename T>
+void benchmarkRelay(const char *name, T &node)
+{
+  // Sends the current state again, so the relay doesn't switch. Each command also
+  // logs and publishes the state, like a command that arrives via MQTT.
+  HomieRange range = {false, 0};
+  String value = node.getRelay() ? "true" : "false";
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < BENCHMARK_RUNS; i++)
+  {
+    node.handleInput(range, cOnTopic, value);
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  Homie.getLogger() << name << F(" set command: ") << cycles / BENCHMARK_RUNS << F(" cycles") << endl;
+}
+
+template <typename T>
+void benchmarkContact(const char *name, T &node)
+{
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < BENCHMARK_RUNS; i++)
+  {
+    node.loop();
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  Homie.getLogger() << name << F(" loop: ") << cycles / BENCHMARK_RUNS << F(" cycles") << endl;
+}
+
+void setup()
+{
+  Homie_setFirmware(FW_NAME, FW_VERSION);
+
+  Serial.begin(SERIAL_SPEED);
+  Serial << endl
+         << endl;
+
+  relay.beforeHomieSetup();
+  relayT.beforeHomieSetup();
+
+  Homie.disableLedFeedback();
+  Homie.disableResetTrigger();
+
+  Homie.setup();
+
+  // The nodes have set up their pins in Homie.setup()
+  benchmarkRelay("RelayNode  ", relay);
+  benchmarkRelay("RelayNodeT ", relayT);
+  benchmarkContact("ContactNode ", contact);
+  benchmarkContact("ContactNodeT", contactT);
+}
+
+void loop()
+{
+  Homie.loop();
+}
@@ -0,0 +1,75 @@
+/*
+ * AcquisitionTask.cpp
+ * Runs the conversions of sensor nodes in a separate task, pinned to one
+ * core of the ESP32, so that slow sensors don't delay WiFi and MQTT. The task
+ * only reads the raw values, the Homie loop processes and publishes them.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "AcquisitionTask.hpp"
+
+#ifdef ACQUISITION_TASK
+
+#include "SensorNode.hpp"
+
+AcquisitionTask::AcquisitionTask(uint8_t core, uint32_t stackSize, uint8_t priority)
+    : _core(core),
+      _stackSize(stackSize),
+      _priority(priority)
+{
+}
+
+AcquisitionTask::~AcquisitionTask()
+{
+  end();
+}
+
+bool AcquisitionTask::add(SensorNode &node)
+{
+  if (_nodeCount >= MAX_NODES)
+  {
+    return false;
+  }
+  _nodes[_nodeCount++] = &node;
+  node.setAcquisitionTask(this);
+  return true;
+}
+
+void AcquisitionTask::runOnce()
+{
+  for (uint8_t i = 0; i < _nodeCount; i++)
+  {
+    _nodes[i]->convert();
+  }
+}
+
+void AcquisitionTask::run(void *parameter)
+{
+  AcquisitionTask *task = (AcquisitionTask *)parameter;
+  for (;;)
+  {
+    task->runOnce();
+    vTaskDelay(pdMS_TO_TICKS(IDLE_DELAY));
+  }
+}
+
+void AcquisitionTask::begin()
+{
+  if (!_task)
+  {
+    xTaskCreatePinnedToCore(run, "acquisition", _stackSize, this, _priority, &_task, _core);
+  }
+}
+
+void AcquisitionTask::end()
+{
+  if (_task)
+  {
+    vTaskDelete(_task);
+    _task = NULL;
+  }
+}
+
+#endif
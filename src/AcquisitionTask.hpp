@@ -0,0 +1,53 @@
+/*
+ * AcquisitionTask.hpp
+ * Runs the conversions of sensor nodes in a separate task, pinned to one
+ * core of the ESP32, so that slow sensors don't delay WiFi and MQTT. The task
+ * only reads the raw values, the Homie loop processes and publishes them.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// The ESP8266 has only one core and no preemptive tasks
+#ifdef ESP32
+#define ACQUISITION_TASK
+#endif
+
+#ifdef ACQUISITION_TASK
+
+class SensorNode;
+
+class AcquisitionTask
+{
+private:
+  static const int MAX_NODES = 16;
+  static const int IDLE_DELAY = 1; // Milliseconds between two passes over all nodes
+
+  SensorNode *_nodes[MAX_NODES];
+  uint8_t _nodeCount = 0;
+  uint8_t _core;
+  uint32_t _stackSize;
+  uint8_t _priority;
+
+  TaskHandle_t _task = NULL;
+
+  static void run(void *parameter);
+  void runOnce();
+
+public:
+  // The Arduino loop and with it Homie run on core 1 of the ESP32
+  explicit AcquisitionTask(uint8_t core = 0, uint32_t stackSize = 4096, uint8_t priority = 1);
+  ~AcquisitionTask();
+
+  // Must be called before begin()
+  bool add(SensorNode &node);
+  // Call after Homie.setup()
+  void begin();
+  void end();
+};
+
+#endif
@@ -20,8 +20,8 @@ AdcNode::AdcNode(const char *id, const char *name, const int sendInterval)
   _adcBattMin = new HomieSetting<double>("battMin", "Measured voltage that corresponds to 0% battery level.  [2.5V .. 4.0V] Default = 2.6V. Must be less than battMax");
   _adcBattMax = new HomieSetting<double>("battMax", "Measured voltage that corresponds to 100% battery level.  [2.5V .. 4.0V] Default = 3.3V. Must be greater than battMin");
 
-  _lastReadTime = millis() - READ_INTERVAL_MILLISECONDS - 1;
-  _lastSendTime = millis() - sendInterval - 1;
+  _measurementInterval = READ_INTERVAL_MILLISECONDS / 1000;
+  _lastSendTime = NodeClock::now() - sendInterval - 1;
   _sendInterval = sendInterval;
 
   asprintf(&_caption, cCaption, name);
@@ -39,9 +39,19 @@ AdcNode::AdcNode(const char *id, const char *name, const int sendInterval)
       .setUnit(cUnitPercent);
 }
 
-void AdcNode::readVoltage()
+void AdcNode::sample()
 {
-  uint16_t v_raw = ESP.getVcc();
+#ifdef ESP8266
+  _rawVoltage = ESP.getVcc();
+#else
+  // The ESP32 can't measure its own supply voltage, measure A0 through a voltage divider instead
+  _rawVoltage = analogReadMilliVolts(A0) * 1024UL / 1000UL;
+#endif
+}
+
+void AdcNode::collect()
+{
+  uint16_t v_raw = trace(0, _rawVoltage);
   _voltage = (((float)v_raw / 1024.0f) * _adcCorrection->get());
   if (isnan(_voltage))
   {
@@ -51,6 +61,8 @@ void AdcNode::readVoltage()
   {
     _batteryLevel = 100 * (_voltage - _adcBattMin->get()) / (_adcBattMax->get() - _adcBattMin->get());
   }
+  countSample(!isnan(_voltage));
+  _lastMeasurement = NodeClock::now();
 }
 
 String AdcNode::getVoltageStr(void)
@@ -70,6 +82,7 @@ String AdcNode::getVoltageStr(void)
 
 void AdcNode::send()
 {
+  PROFILE_PHASE(PHASE_SEND);
   printCaption();
 
   if (isnan(_voltage))
@@ -83,48 +96,50 @@ void AdcNode::send()
     Homie.getLogger() << cIndent << F("Battery level: ") << _batteryLevel << "%" << endl;
     sendData();
   }
+  publishBatch();
 }
 
 void AdcNode::sendError()
 {
-  if (Homie.isConnected())
-  {
-    setProperty(cStatusTopic).send("error");
-  }
+  publish(cStatusTopic, "error");
 }
 
 void AdcNode::sendData()
 {
-  if (Homie.isConnected())
-  {
-    setProperty(cStatusTopic).send("ok");
-    setProperty(cVoltageTopic).send(String(_voltage));
-    setProperty(cBatteryLevelTopic).send(String(_batteryLevel));
-  }
+  publish(cStatusTopic, "ok");
+  publish(cVoltageTopic, _voltage);
+  publish(cBatteryLevelTopic, _batteryLevel);
 }
 
 void AdcNode::onReadyToOperate()
 {
   send();
+  SensorNode::onReadyToOperate();
 };
 
 void AdcNode::loop()
 {
-  unsigned long now = millis();
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+}
 
-  if (now - _lastReadTime >= READ_INTERVAL_MILLISECONDS)
-  {
-    readVoltage();
-    _lastReadTime = now;
-  }
+void AdcNode::acquire()
+{
+  runMeasurement(isMeasurementDue());
 
-  if (now - _lastSendTime >= _sendInterval)
+  if (isDue(_lastSendTime, _sendInterval))
   {
     send();
-    _lastSendTime = now;
+    _lastSendTime = NodeClock::now();
   }
 }
 
+unsigned long AdcNode::untilAcquire()
+{
+  return earlier(untilMeasurement(), untilDue(_lastSendTime, _sendInterval));
+}
+
 void AdcNode::beforeHomieSetup()
 {
   // Has to be called manually before Homie.setup()
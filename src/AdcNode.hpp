@@ -28,20 +28,21 @@ private:
   HomieSetting<double> *_adcBattMax;
   HomieSetting<double> *_adcBattMin;
 
-  unsigned long _lastReadTime;
   unsigned long _lastSendTime;
   unsigned long _sendInterval;
 
   float _batteryLevel = NAN;
   float _voltage = NAN;
+  uint16_t _rawVoltage = 0; // Read by sample(), processed by collect()
 
-  void readVoltage();
   void send();
   void sendError();
   void sendData();
 
 protected:
   virtual void setup() override;
+  virtual void acquire() override;
+  virtual unsigned long untilAcquire() override;
   virtual void loop() override;
   virtual void onReadyToOperate() override;
 
@@ -50,6 +51,9 @@ public:
                    const char *name,
                    const int sendInterval = SEND_INTERVAL_MILLISECONDS);
 
+  virtual void sample() override;
+  virtual void collect() override;
+
   float getBatteryLevel() const { return _batteryLevel; }
   float getVoltage() const { return _voltage; }
   String getVoltageStr();
@@ -20,13 +20,13 @@ BME280Node::BME280Node(const char *id,
                        const Adafruit_BME280::sensor_filter filter)
     : SensorNode(id, name, "BME280"),
       _i2cAddress(i2cAddress),
-      _lastMeasurement(0),
       _tempSampling(tempSampling),
       _pressSampling(pressSampling),
       _humSampling(humSampling),
       _filter(filter)
 {
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
+  _conversionTime = computeConversionTime();
 
   asprintf(&_temperatureOffsetName, "%s.temperatureOffset", id);
   _temperatureOffset = new HomieSetting<double>(_temperatureOffsetName, "The temperature offset in degrees [-10.0 .. 10.0] Default = 0");
@@ -55,6 +55,7 @@ BME280Node::BME280Node(const char *id,
 
 void BME280Node::send()
 {
+  PROFILE_PHASE(PHASE_SEND);
   printCaption();
 
   float absHumidity = computeAbsoluteHumidity(temperature, humidity);
@@ -66,40 +67,95 @@ void BME280Node::send()
   Homie.getLogger() << cIndent << F("Pressure: ") << pressure << " hPa" << endl;
   Homie.getLogger() << cIndent << F("Abs humidity: ") << absHumidity << " g/m³" << endl;
 
-  if (Homie.isConnected())
+  publish(cStatusTopic, "ok");
+  publish(cTemperatureTopic, temperature);
+  publish(cHumidityTopic, humidity);
+  publish(cPressureTopic, pressure);
+  publish(cAbsHumidityTopic, absHumidity);
+  publishBatch();
+}
+
+unsigned long BME280Node::computeConversionTime()
+{
+  // Maximum measurement time from the BME280 datasheet, section 9.1:
+  // 1.25 + 2.3 * T_osrs + (2.3 * P_osrs + 0.575) + (2.3 * H_osrs + 0.575) [ms]
+  float ms = 1.25;
+  if (_tempSampling != Adafruit_BME280::SAMPLING_NONE)
+  {
+    ms += 2.3 * (1 << (_tempSampling - 1));
+  }
+  if (_pressSampling != Adafruit_BME280::SAMPLING_NONE)
+  {
+    ms += 2.3 * (1 << (_pressSampling - 1)) + 0.575;
+  }
+  if (_humSampling != Adafruit_BME280::SAMPLING_NONE)
   {
-    setProperty(cStatusTopic).send("ok");
-    setProperty(cTemperatureTopic).send(String(temperature));
-    setProperty(cHumidityTopic).send(String(humidity));
-    setProperty(cPressureTopic).send(String(pressure));
-    setProperty(cAbsHumidityTopic).send(String(absHumidity));
+    ms += 2.3 * (1 << (_humSampling - 1)) + 0.575;
   }
+  return (unsigned long)ceil(ms);
 }
 
-void BME280Node::loop()
+void BME280Node::start()
 {
-  if (_sensorFound)
+  if (_sensorFound && !_measuring)
   {
-    if (millis() - _lastMeasurement >= _measurementInterval * 1000UL ||
-        _lastMeasurement == 0)
-    {
-      bme.takeForcedMeasurement(); // has no effect in normal mode
+    // Writing the control register in forced mode triggers a single conversion.
+    // takeForcedMeasurement() would do the same, but busy-wait until it is finished.
+    bme.setSampling(Adafruit_BME280::MODE_FORCED, _tempSampling, _pressSampling, _humSampling, _filter);
+    _conversionStart = NodeClock::now();
+    _measuring = true;
+  }
+}
 
-      temperature = bme.readTemperature();
-      humidity = bme.readHumidity();
-      pressure = bme.readPressure() / 100;
+bool BME280Node::ready()
+{
+  return NodeClock::now() - _conversionStart >= _conversionTime;
+}
 
-      fixRange(&temperature, cMinTemp, cMaxTemp);
-      fixRange(&humidity, cMinHumid, cMaxHumid);
-      fixRange(&pressure, cMinPress, cMaxPress);
+void BME280Node::sample()
+{
+  _rawTemperature = bme.readTemperature();
+  _rawHumidity = bme.readHumidity();
+  _rawPressure = bme.readPressure() / 100;
+}
 
-      send();
+void BME280Node::collect()
+{
+  temperature = trace(0, _rawTemperature);
+  humidity = trace(1, _rawHumidity);
+  pressure = trace(2, _rawPressure);
+
+  fixRange(&temperature, cMinTemp, cMaxTemp);
+  fixRange(&humidity, cMinHumid, cMaxHumid);
+  fixRange(&pressure, cMinPress, cMaxPress);
+
+  countSample(!isnan(temperature) && !isnan(humidity) && !isnan(pressure));
+  send();
+
+  adaptInterval(temperature);
+  _lastMeasurement = NodeClock::now();
+}
 
-      _lastMeasurement = millis();
-    }
+void BME280Node::loop()
+{
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+}
+
+void BME280Node::acquire()
+{
+  if (_sensorFound)
+  {
+    runMeasurement(isMeasurementDue());
   }
 }
 
+unsigned long BME280Node::untilAcquire()
+{
+  return _sensorFound ? untilMeasurement() : TicklessIdle::FOREVER;
+}
+
 void BME280Node::beforeHomieSetup()
 {
   _temperatureOffset->setDefaultValue(0.0f).setValidator([](float candidate) {
@@ -109,10 +165,11 @@ void BME280Node::beforeHomieSetup()
 
 void BME280Node::onReadyToOperate()
 {
-  if (!_sensorFound && Homie.isConnected())
+  if (!_sensorFound)
   {
-    setProperty(cStatusTopic).send("error");
+    publish(cStatusTopic, "error");
   }
+  SensorNode::onReadyToOperate();
 };
 
 void BME280Node::setup()
@@ -130,6 +187,7 @@ void BME280Node::setup()
   else
   {
     _sensorFound = false;
+    _stats.readErrors++;
     Homie.getLogger() << cIndent << F("not found. Check wiring!") << endl;
   }
 }
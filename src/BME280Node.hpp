@@ -31,8 +31,8 @@ private:
   bool _sensorFound = false;
 
   unsigned int _i2cAddress;
-  unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
+  unsigned long _conversionStart = 0;
+  unsigned long _conversionTime; // in milliseconds
 
   Adafruit_BME280::sensor_sampling _tempSampling;
   Adafruit_BME280::sensor_sampling _pressSampling;
@@ -44,15 +44,22 @@ private:
   float temperature = NAN;
   float humidity = NAN;
   float pressure = NAN;
+  // Read by sample(), processed by collect()
+  float _rawTemperature = NAN;
+  float _rawHumidity = NAN;
+  float _rawPressure = NAN;
 
   Adafruit_BME280 bme;
 
+  unsigned long computeConversionTime();
   void send();
 
 protected:
   HomieSetting<double> *_temperatureOffset;
 
   virtual void setup() override;
+  virtual void acquire() override;
+  virtual unsigned long untilAcquire() override;
   virtual void loop() override;
   virtual void onReadyToOperate() override;
 
@@ -66,6 +73,11 @@ public:
                       Adafruit_BME280::sensor_sampling humSampling = Adafruit_BME280::SAMPLING_X1,
                       Adafruit_BME280::sensor_filter filter = Adafruit_BME280::FILTER_OFF);
 
+  virtual void start() override;
+  virtual bool ready() override;
+  virtual void sample() override;
+  virtual void collect() override;
+
   float getHumidity() const { return humidity; }
   float getTemperature() const { return temperature; }
   float getPressure() const { return pressure; }
@@ -19,14 +19,14 @@ const char *name,
       _buttonChangeCallback(buttonChangeCallback)
 {
   asprintf(&_caption, cCaption, name, buttonPin);
+  // Report button presses immediately, not in the next publish window
+  _alignPublishes = false;
 }
 
 void ButtonNode::handleButtonPress(unsigned long dt)
 {
-  if (Homie.isConnected())
-  {
-    setProperty("duration").send(String(dt));
-  }
+  publish(cDurationTopic, (long)dt);
+  publishBatch();
 
   printCaption();
   Homie.getLogger() << cIndent << F("pressed: ") << dt << " ms" << endl;
@@ -39,10 +39,8 @@ void ButtonNode::handleButtonPress(unsigned long dt)
 
 void ButtonNode::handleButtonChange(bool down)
 {
-  if (Homie.isConnected())
-  {
-    setProperty("down").send(down ? F("true") : F("false"));
-  }
+  publish(cDownTopic, down ? F("true") : F("false"));
+  publishBatch();
 
   printCaption();
   Homie.getLogger() << cIndent << (down ? F("down") : F("up")) << endl;
@@ -75,6 +73,10 @@ void ButtonNode::setMaxButtonDownTime(unsigned short downTime)
 
 void ButtonNode::loop()
 {
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+
   // Detect a single press between 90ms and 900ms
   // This could be improved to detect multiple quick or long presses
   // and:
@@ -82,15 +84,15 @@ void ButtonNode::loop()
   //  b) react by calling different callbacks
   if (_buttonPin > DEFAULTPIN)
   {
-    byte reading = digitalRead(_buttonPin);
+    byte reading = trace(0, digitalRead(_buttonPin));
 
     if (reading != _lastReading)
     {
       // reset the debouncing timer
-      _lastDebounceTime = millis();
+      _lastDebounceTime = NodeClock::now();
     }
 
-    if ((millis() - _lastDebounceTime) > _minButtonDownTime)
+    if ((NodeClock::now() - _lastDebounceTime) > _minButtonDownTime)
     {
       // whatever the reading is at, it's been there for longer than the debounce
       // delay, so take it as the actual current state:
@@ -102,7 +104,7 @@ void ButtonNode::loop()
         {
           handleButtonChange(true);
           _buttonChangeHandled = true;
-          _buttonDownTime = millis();
+          _buttonDownTime = NodeClock::now();
           _buttonPressHandled = false;
         }
         else
@@ -110,7 +112,7 @@ void ButtonNode::loop()
           handleButtonChange(false);
           _buttonChangeHandled = true;
 
-          unsigned long dt = millis() - _buttonDownTime;
+          unsigned long dt = NodeClock::now() - _buttonDownTime;
           if (dt >= _minButtonDownTime && dt <= _maxButtonDownTime && !_buttonPressHandled)
           {
             handleButtonPress(dt);
@@ -123,15 +125,34 @@ void ButtonNode::loop()
   }
 }
 
+unsigned long ButtonNode::nextDeadline()
+{
+  unsigned long deadline = SensorNode::nextDeadline();
+  if (_buttonPin <= DEFAULTPIN)
+  {
+    return deadline;
+  }
+  if (_lastReading != _buttonState)
+  {
+    // Wait until the debounce time has passed
+    return earlier(deadline, untilElapsed(_lastDebounceTime, _minButtonDownTime + 1));
+  }
+  return _wakeOnPin ? deadline : earlier(deadline, POLL_INTERVAL);
+}
+
 void ButtonNode::setup()
 {
-  advertise("down").setDatatype("boolean");
-  advertise("duration").setDatatype("integer").setUnit("ms");
+  advertise(cDownTopic).setDatatype("boolean");
+  advertise(cDurationTopic).setDatatype("integer").setUnit("ms");
 
   printCaption();
 
   if (_buttonPin > DEFAULTPIN)
   {
     pinMode(_buttonPin, INPUT_PULLUP);
+    if (TicklessIdle::active)
+    {
+      _wakeOnPin = TicklessIdle::active->wakeOn(_buttonPin);
+    }
   }
 }
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "SensorNode.hpp"
+#include "constants.hpp"
 
 #define DEFAULTPIN -1
 
@@ -32,12 +33,14 @@ private:
   unsigned long _minButtonDownTime = 90;
   unsigned long _maxButtonDownTime = 2000;
   unsigned long _lastDebounceTime = 0; // the last time the button pin was toggled
+  bool _wakeOnPin = false;             // A pin interrupt ends TicklessIdle::idle()
 
   void handleButtonPress(unsigned long dt);
   void handleButtonChange(bool down);
 
 protected:
   virtual void loop() override;
+  virtual unsigned long nextDeadline() override;
   virtual void setup() override;
 
 public:
@@ -0,0 +1,92 @@
+/*
+ * CommandParser.cpp
+ * Allocation free parsing of the messages that settable nodes receive in
+ * handleInput().
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "CommandParser.hpp"
+
+#include <errno.h>
+
+int8_t CommandParser::addProperty(const char *name)
+{
+  if (_propertyCount >= MAX_PROPERTIES)
+  {
+    return UNKNOWN_PROPERTY;
+  }
+  _properties[_propertyCount] = {name, (uint8_t)strlen(name)};
+  return _propertyCount++;
+}
+
+int8_t CommandParser::findProperty(const String &property) const
+{
+  // Comparing the precomputed lengths first rules out most properties without touching the strings
+  unsigned int length = property.length();
+  for (uint8_t i = 0; i < _propertyCount; i++)
+  {
+    if ((_properties[i].length == length) && (memcmp(_properties[i].name, property.c_str(), length) == 0))
+    {
+      return i;
+    }
+  }
+  return UNKNOWN_PROPERTY;
+}
+
+bool CommandParser::parseLong(const char *s, long &value)
+{
+  // Like the former String check: an optional '-' and digits only, no whitespace, no '+'
+  // and nothing that doesn't fit into a long
+  if (!isdigit((unsigned char)s[0]) && !((s[0] == '-') && isdigit((unsigned char)s[1])))
+  {
+    return false;
+  }
+  char *end;
+  errno = 0;
+  long result = strtol(s, &end, 10);
+  if ((*end != '\0') || (errno == ERANGE))
+  {
+    return false;
+  }
+  value = result;
+  return true;
+}
+
+CommandParser::Switch CommandParser::parseSwitch(const char *s, long &argument)
+{
+  const char *colon = strchr(s, ':');
+  size_t length = colon ? (size_t)(colon - s) : strlen(s);
+  Switch result = SWITCH_INVALID;
+
+  switch (length)
+  {
+  case 2:
+    result = (strncmp(s, "on", 2) == 0) ? SWITCH_ON : SWITCH_INVALID;
+    break;
+  case 3:
+    result = (strncmp(s, "off", 3) == 0) ? SWITCH_OFF : SWITCH_INVALID;
+    break;
+  case 4:
+    result = (strncmp(s, "true", 4) == 0) ? SWITCH_ON : SWITCH_INVALID;
+    break;
+  case 5:
+    result = (strncmp(s, "false", 5) == 0) ? SWITCH_OFF : SWITCH_INVALID;
+    break;
+  case 6:
+    result = (strncmp(s, "toggle", 6) == 0) ? SWITCH_TOGGLE : SWITCH_INVALID;
+    break;
+  }
+
+  if ((result != SWITCH_INVALID) && colon)
+  {
+    long value;
+    if (!parseLong(colon + 1, value) || (value <= 0))
+    {
+      return SWITCH_INVALID;
+    }
+    argument = value;
+  }
+  return result;
+}
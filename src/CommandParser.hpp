@@ -0,0 +1,50 @@
+/*
+ * CommandParser.hpp
+ * Allocation free parsing of the messages that settable nodes receive in
+ * handleInput().
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class CommandParser
+{
+public:
+  static const int8_t UNKNOWN_PROPERTY = -1;
+
+  enum Switch
+  {
+    SWITCH_INVALID,
+    SWITCH_OFF,
+    SWITCH_ON,
+    SWITCH_TOGGLE
+  };
+
+private:
+  static const int MAX_PROPERTIES = 8;
+
+  struct Property
+  {
+    const char *name;
+    uint8_t length;
+  };
+
+  Property _properties[MAX_PROPERTIES];
+  uint8_t _propertyCount = 0;
+
+public:
+  // Register the settable properties in the order of their ids, e.g. an enum
+  int8_t addProperty(const char *name);
+  // Returns the id of the property or UNKNOWN_PROPERTY
+  int8_t findProperty(const String &property) const;
+
+  // Accepts decimal integers with an optional "-" that fit into a long, nothing else
+  static bool parseLong(const char *s, long &value);
+  // Accepts true|false|on|off|toggle, optionally followed by :<seconds>,
+  // e.g. "on:30". argument is only changed if one is given.
+  static Switch parseSwitch(const char *s, long &argument);
+};
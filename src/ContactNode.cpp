@@ -12,96 +12,30 @@ ContactNode::ContactNode(const char *id,
                          const char *name,
                          const int contactPin,
                          TContactCallback contactCallback)
-    : SensorNode(id, name, "Contact"),
-      _contactPin(contactPin),
+    : ContactNodeImpl(id, name, contactPin, DEBOUNCE_TIME),
       _contactCallback(contactCallback)
 {
-  asprintf(&_caption, cCaption, name, contactPin);
 }
 
-int ContactNode::getContactPin()
+bool ContactNode::hasContact()
 {
-  return _contactPin;
+  return getContactPin() > DEFAULTPIN;
 }
 
 byte ContactNode::readPin()
 {
-  return digitalRead(_contactPin);
+  return digitalRead(getContactPin());
 }
 
-// Debounce input pin.
-bool ContactNode::debouncePin(void)
+void ContactNode::contactChanged(bool open)
 {
-  byte inputState = readPin();
-  if (inputState != _lastInputState)
-  {
-    _stateChangedTime = millis();
-    _stateChangeHandled = false;
-    _lastInputState = inputState;
-#ifdef DEBUG
-    Homie.getLogger() << F("State Changed to ") << inputState << endl;
-#endif
-  }
-  else
-  {
-    unsigned long dt = millis() - _stateChangedTime;
-    if (dt >= DEBOUNCE_TIME && !_stateChangeHandled)
-    {
-#ifdef DEBUG
-      Homie.getLogger() << F("State Stable for ") << dt << "ms" << endl;
-#endif
-      _stateChangeHandled = true;
-      return true;
-    }
-  }
-  return false;
-}
-
-void ContactNode::handleStateChange(bool open)
-{
-  if (Homie.isConnected())
-  {
-    setProperty("open").send(open ? F("true") : F("false"));
-  }
   if (_contactCallback)
   {
     _contactCallback(open);
   }
-
-  printCaption();
-  Homie.getLogger() << cIndent << F("is ") << (open ? F("open") : F("closed")) << endl;
 }
 
 void ContactNode::onChange(TContactCallback contactCallback)
 {
   _contactCallback = contactCallback;
 }
-
-void ContactNode::loop()
-{
-  if (_contactPin > DEFAULTPIN)
-  {
-    if (debouncePin() && (_lastSentState != _lastInputState))
-    {
-      handleStateChange(_lastInputState == HIGH);
-      _lastSentState = _lastInputState;
-    }
-  }
-}
-
-void ContactNode::setupPin()
-{
-  pinMode(_contactPin, INPUT_PULLUP);
-}
-
-void ContactNode::setup()
-{
-  advertise("open").setDatatype("boolean");
-
-  printCaption();
-
-  if (_contactPin > DEFAULTPIN)
-  {
-    setupPin();
-  }
-}
@@ -8,37 +8,27 @@
 
 #pragma once
 
-#include "SensorNode.hpp"
+#include "ContactNodeBase.hpp"
+#include "constants.hpp"
 
 #define DEFAULTPIN -1
 #define DEBOUNCE_TIME 200
 
-class ContactNode : public SensorNode
+class ContactNode : public ContactNodeImpl<ContactNode>
 {
+  friend class ContactNodeImpl<ContactNode>;
+
 public:
   typedef std::function<void(bool)> TContactCallback;
 
 private:
-  const char *cCaption = "• %s contact pin[%d]:";
-
-  int _contactPin;
   TContactCallback _contactCallback;
 
-  // Use invalid values for last states to force sending initial state...
-  int _lastInputState = -1; // Input pin state.
-  int _lastSentState = -1;  // Last pin state sent
-  bool _stateChangeHandled = false;
-  unsigned long _stateChangedTime = 0;
-
-  bool debouncePin(void);
-  void handleStateChange(bool open);
-
 protected:
-  int getContactPin();
-  virtual void loop() override;
-  virtual void setup() override;
-  virtual void setupPin();
+  bool hasContact();
+  // Override to read the contact in another way, e.g. through a port expander
   virtual byte readPin();
+  void contactChanged(bool open);
 
 public:
   explicit ContactNode(const char *id, const char *name, const int contactPin = DEFAULTPIN, TContactCallback contactCallback = NULL);
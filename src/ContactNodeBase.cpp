@@ -0,0 +1,117 @@
+/*
+ * ContactNodeBase.cpp
+ * Debouncing and state publishing shared by ContactNode and ContactNodeT.
+ * ContactNodeImpl in the header reads the pin and calls the callback.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "ContactNodeBase.hpp"
+
+ContactNodeBase::ContactNodeBase(const char *id,
+                                 const char *name,
+                                 const int contactPin,
+                                 unsigned long debounceTime)
+    : SensorNode(id, name, "Contact"),
+      _contactPin(contactPin),
+      _debounceTime(debounceTime)
+{
+  asprintf(&_caption, cCaption, name, contactPin);
+  // Report state changes immediately, not in the next publish window
+  _alignPublishes = false;
+}
+
+int ContactNodeBase::getContactPin()
+{
+  return _contactPin;
+}
+
+bool ContactNodeBase::isOpen()
+{
+  return _lastSentState == HIGH;
+}
+
+// Debounce input pin.
+bool ContactNodeBase::debouncePin(byte inputState)
+{
+  if (inputState != _lastInputState)
+  {
+    _stateChangedTime = NodeClock::now();
+    _stateChangeHandled = false;
+    _lastInputState = inputState;
+#ifdef DEBUG
+    Homie.getLogger() << F("State Changed to ") << inputState << endl;
+#endif
+  }
+  else
+  {
+    unsigned long dt = NodeClock::now() - _stateChangedTime;
+    if (dt >= _debounceTime && !_stateChangeHandled)
+    {
+#ifdef DEBUG
+      Homie.getLogger() << F("State Stable for ") << dt << "ms" << endl;
+#endif
+      _stateChangeHandled = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ContactNodeBase::handleStateChange(bool open)
+{
+  publish(cOpenTopic, open ? F("true") : F("false"));
+  publishBatch();
+
+  printCaption();
+  Homie.getLogger() << cIndent << F("is ") << (open ? F("open") : F("closed")) << endl;
+}
+
+bool ContactNodeBase::updateState(byte inputState)
+{
+  if (debouncePin(trace(0, inputState)) && (_lastSentState != _lastInputState))
+  {
+    _lastSentState = _lastInputState;
+    handleStateChange(isOpen());
+    return true;
+  }
+  return false;
+}
+
+unsigned long ContactNodeBase::nextDeadline()
+{
+  unsigned long deadline = SensorNode::nextDeadline();
+  if (_contactPin <= DEFAULTPIN)
+  {
+    return deadline;
+  }
+  if (!_stateChangeHandled)
+  {
+    // Wait until the debounce time has passed
+    return earlier(deadline, untilElapsed(_stateChangedTime, _debounceTime));
+  }
+  return _wakeOnPin ? deadline : earlier(deadline, POLL_INTERVAL);
+}
+
+void ContactNodeBase::setupPin()
+{
+  pinMode(_contactPin, INPUT_PULLUP);
+  // Pins that are read in a derived class, e.g. through a port expander, are polled
+  if (TicklessIdle::active)
+  {
+    _wakeOnPin = TicklessIdle::active->wakeOn(_contactPin);
+  }
+}
+
+void ContactNodeBase::setup()
+{
+  advertise(cOpenTopic).setDatatype("boolean");
+
+  printCaption();
+
+  if (_contactPin > DEFAULTPIN)
+  {
+    setupPin();
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * ContactNodeBase.hpp
+ * Debouncing and state publishing shared by ContactNode and ContactNodeT.
+ * ContactNodeImpl reads the pin and calls the callback of the derived class
+ * without virtual calls.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include "SensorNode.hpp"
+#include "constants.hpp"
+
+#define DEFAULTPIN -1
+
+class ContactNodeBase : public SensorNode
+{
+private:
+  const char *cCaption = "• %s contact pin[%d]:";
+
+  int _contactPin;
+  unsigned long _debounceTime;
+
+  // Use invalid values for last states to force sending initial state...
+  int _lastInputState = -1; // Input pin state.
+  int _lastSentState = -1;  // Last pin state sent
+  bool _stateChangeHandled = false;
+  unsigned long _stateChangedTime = 0;
+  bool _wakeOnPin = false; // A pin interrupt ends TicklessIdle::idle()
+
+  bool debouncePin(byte inputState);
+  void handleStateChange(bool open);
+
+protected:
+  int getContactPin();
+  // Debounces the state of the pin. Returns true if a new stable state was published.
+  bool updateState(byte inputState);
+  bool isOpen();
+  virtual unsigned long nextDeadline() override;
+  virtual void setup() override;
+  virtual void setupPin();
+
+  explicit ContactNodeBase(const char *id, const char *name, const int contactPin, unsigned long debounceTime);
+};
+
+// The parts that read the contact. Derived implements hasContact(), readPin() and
+// contactChanged(bool open), which is called after the new state was published. They
+// are called directly, so a ContactNodeT reads its pin and calls its callback without
+// a virtual call.
+template <typename Derived>
+class ContactNodeImpl : public ContactNodeBase
+{
+private:
+  Derived &contact()
+  {
+    return *static_cast<Derived *>(this);
+  }
+
+protected:
+  virtual void loop() override
+  {
+    LoopTimer loopTimer(*this);
+    PROFILE_PHASE(PHASE_LOOP);
+    SensorNode::loop();
+
+    if (contact().hasContact() && updateState(contact().readPin()))
+    {
+      contact().contactChanged(isOpen());
+    }
+  }
+
+  explicit ContactNodeImpl(const char *id, const char *name, const int contactPin, unsigned long debounceTime)
+      : ContactNodeBase(id, name, contactPin, debounceTime)
+  {
+  }
+};
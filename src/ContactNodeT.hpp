@@ -0,0 +1,49 @@
+/*
+ * ContactNodeT.hpp
+ * Homie Node for a Contact switch.
+ * The pin, the debounce time and the optional callback are template parameters,
+ * so reading the pin and calling the callback are resolved at compile time.
+ * The debouncing and the publishing are shared with ContactNode in ContactNodeBase.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include "ContactNodeBase.hpp"
+#include "constants.hpp"
+
+#define DEFAULTPIN -1
+
+// Default for the callback. The call is direct, so the compiler removes it completely.
+inline void noContactCallback(bool open) {}
+
+template <int8_t ContactPin, unsigned long DebounceTime = 200, void (*ContactCallback)(bool) = noContactCallback>
+class ContactNodeT : public ContactNodeImpl<ContactNodeT<ContactPin, DebounceTime, ContactCallback>>
+{
+  static_assert(ContactPin > DEFAULTPIN, "ContactNodeT needs a contact pin");
+  friend class ContactNodeImpl<ContactNodeT>;
+
+protected:
+  bool hasContact()
+  {
+    return true;
+  }
+
+  byte readPin()
+  {
+    return digitalRead(ContactPin);
+  }
+
+  void contactChanged(bool open)
+  {
+    ContactCallback(open);
+  }
+
+public:
+  explicit ContactNodeT(const char *id, const char *name)
+      : ContactNodeImpl<ContactNodeT>(id, name, ContactPin, DebounceTime)
+  {
+  }
+};
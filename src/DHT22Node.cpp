@@ -12,10 +12,10 @@
 
 DHT22Node::DHT22Node(const char *id, const char *name, const int sensorPin, const int measurementInterval)
     : SensorNode(id, name, "DHT22"),
-      _sensorPin(sensorPin),
-      _measurementInterval(measurementInterval),
-      _lastMeasurement(0)
+      _sensorPin(sensorPin)
 {
+  _measurementInterval = measurementInterval;
+
   if (_sensorPin > DEFAULTPIN)
   {
     dht = new DHT(_sensorPin, DHTTYPE);
@@ -41,16 +41,13 @@ DHT22Node::DHT22Node(const char *id, const char *name, const int sensorPin, cons
 
 void DHT22Node::send()
 {
+  PROFILE_PHASE(PHASE_SEND);
   printCaption();
 
   if (isnan(temperature) || isnan(humidity))
   {
     Homie.getLogger() << cIndent << F("Error reading from Sensor") << endl;
-
-    if (Homie.isConnected())
-    {
-      setProperty(cStatusTopic).send("error");
-    }
+    publish(cStatusTopic, "error");
   }
   else
   {
@@ -60,36 +57,60 @@ void DHT22Node::send()
     Homie.getLogger() << cIndent << F("Humidity: ") << humidity << " %" << endl;
     Homie.getLogger() << cIndent << F("Abs humidity: ") << absHumidity << " g/m³" << endl;
 
-    if (Homie.isConnected())
-    {
-      setProperty(cStatusTopic).send("ok");
-      setProperty(cTemperatureTopic).send(String(temperature));
-      setProperty(cHumidityTopic).send(String(humidity));
-      setProperty(cAbsHumidityTopic).send(String(absHumidity));
-    }
+    publish(cStatusTopic, "ok");
+    publish(cTemperatureTopic, temperature);
+    publish(cHumidityTopic, humidity);
+    publish(cAbsHumidityTopic, absHumidity);
   }
+  publishBatch();
 }
 
-void DHT22Node::loop()
+void DHT22Node::sample()
 {
-  if (dht)
-  {
-    if ((millis() - _lastMeasurement >= _measurementInterval * 1000UL) ||
-        (_lastMeasurement == 0))
-    {
-      temperature = dht->readTemperature();
-      humidity = dht->readHumidity();
+  // The DHT22 has no separate conversion phase, the whole transfer happens here.
+  // The library disables interrupts during the transfer, so the profiler counts
+  // the whole read as an upper bound. readHumidity() returns the cached value.
+  PROFILE_INTERRUPTS_OFF();
+  _rawTemperature = dht->readTemperature();
+  PROFILE_INTERRUPTS_ON();
+  _rawHumidity = dht->readHumidity();
+}
+
+void DHT22Node::collect()
+{
+  temperature = trace(0, _rawTemperature);
+  humidity = trace(1, _rawHumidity);
+
+  fixRange(&temperature, cMinTemp, cMaxTemp);
+  fixRange(&humidity, cMinHumid, cMaxHumid);
+
+  countSample(!isnan(temperature) && !isnan(humidity));
+  send();
 
-      fixRange(&temperature, cMinTemp, cMaxTemp);
-      fixRange(&humidity, cMinHumid, cMaxHumid);
+  adaptInterval(temperature);
+  _lastMeasurement = NodeClock::now();
+}
 
-      send();
+void DHT22Node::loop()
+{
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+}
 
-      _lastMeasurement = millis();
-    }
+void DHT22Node::acquire()
+{
+  if (dht)
+  {
+    runMeasurement(isMeasurementDue());
   }
 }
 
+unsigned long DHT22Node::untilAcquire()
+{
+  return dht ? untilMeasurement() : TicklessIdle::FOREVER;
+}
+
 void DHT22Node::setup()
 {
   printCaption();
@@ -24,11 +24,12 @@ private:
   const char *cCaption = "• %s DHT22 pin[%d]:";
 
   int _sensorPin;
-  unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
 
   float temperature = NAN;
   float humidity = NAN;
+  // Read by sample(), processed by collect()
+  float _rawTemperature = NAN;
+  float _rawHumidity = NAN;
 
   DHT *dht = NULL;
 
@@ -36,6 +37,8 @@ private:
 
 protected:
   virtual void setup() override;
+  virtual void acquire() override;
+  virtual unsigned long untilAcquire() override;
   virtual void loop() override;
 
 public:
@@ -44,6 +47,9 @@ public:
                      const int sensorPin = DEFAULTPIN,
                      const int measurementInterval = MEASUREMENT_INTERVAL);
 
+  virtual void sample() override;
+  virtual void collect() override;
+
   float getHumidity() const { return humidity; }
   float getTemperature() const { return temperature; }
 };
@@ -11,10 +11,10 @@
 
 DS18B20Node::DS18B20Node(const char *id, const char *name, const int sensorPin, const int measurementInterval)
     : SensorNode(id, name, "DS18B20"),
-      _sensorPin(sensorPin),
-      _measurementInterval(measurementInterval),
-      _lastMeasurement(0)
+      _sensorPin(sensorPin)
 {
+  _measurementInterval = measurementInterval;
+
   if (_sensorPin > DEFAULTPIN)
   {
     oneWire = new OneWire(_sensorPin);
@@ -34,6 +34,7 @@ DS18B20Node::DS18B20Node(const char *id, const char *name, const int sensorPin,
 
 void DS18B20Node::send()
 {
+  PROFILE_PHASE(PHASE_SEND);
   printCaption();
 
   if (DEVICE_DISCONNECTED_C == temperature)
@@ -46,48 +47,85 @@ void DS18B20Node::send()
     Homie.getLogger() << cIndent << F("Temperature: ") << temperature << " °C" << endl;
     sendData();
   }
+  publishBatch();
 }
 
 void DS18B20Node::sendError()
 {
-  if (Homie.isConnected())
+  publish(cStatusTopic, "error");
+}
+
+void DS18B20Node::sendData()
+{
+  publish(cStatusTopic, "ok");
+  publish(cTemperatureTopic, temperature);
+}
+
+void DS18B20Node::start()
+{
+  if (_sensorFound && !_measuring)
   {
-    setProperty(cStatusTopic).send("error");
+    // Returns immediately, because waiting for the conversion is disabled in setup()
+    dallasTemp->requestTemperatures();
+    _conversionStart = NodeClock::now();
+    _measuring = true;
   }
 }
 
-void DS18B20Node::sendData()
+bool DS18B20Node::ready()
+{
+  return NodeClock::now() - _conversionStart >= _conversionTime;
+}
+
+void DS18B20Node::sample()
 {
-  if (Homie.isConnected())
+  _rawTemperature = dallasTemp->getTempCByIndex(0);
+}
+
+void DS18B20Node::collect()
+{
+  temperature = trace(0, _rawTemperature);
+  bool valid = (DEVICE_DISCONNECTED_C != temperature);
+  countSample(valid);
+  // A disconnected sensor reads -127, which must not be clamped into the valid range
+  if (valid)
   {
-    setProperty(cStatusTopic).send("ok");
-    setProperty(cTemperatureTopic).send(String(temperature));
+    fixRange(&temperature, cMinTemp, cMaxTemp);
   }
+
+  send();
+
+  adaptInterval(valid ? temperature : NAN);
+  _lastMeasurement = NodeClock::now();
 }
 
 void DS18B20Node::loop()
+{
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+}
+
+void DS18B20Node::acquire()
 {
   if (_sensorFound)
   {
-    if ((millis() - _lastMeasurement >= _measurementInterval * 1000UL) || (_lastMeasurement == 0))
-    {
-      dallasTemp->requestTemperatures();
-      temperature = dallasTemp->getTempCByIndex(0);
-      fixRange(&temperature, cMinTemp, cMaxTemp);
-
-      send();
-
-      _lastMeasurement = millis();
-    }
+    runMeasurement(isMeasurementDue());
   }
 }
 
+unsigned long DS18B20Node::untilAcquire()
+{
+  return _sensorFound ? untilMeasurement() : TicklessIdle::FOREVER;
+}
+
 void DS18B20Node::onReadyToOperate()
 {
   if (!_sensorFound)
   {
     sendError();
   }
+  SensorNode::onReadyToOperate();
 };
 
 void DS18B20Node::setup()
@@ -98,6 +136,10 @@ void DS18B20Node::setup()
   {
     dallasTemp->begin();
     _sensorFound = (dallasTemp->getDS18Count() > 0);
+    // Don't block in requestTemperatures(). The conversion time depends on the resolution
+    // and is used in ready(), polling the bus would not work with parasite power.
+    dallasTemp->setWaitForConversion(false);
+    _conversionTime = dallasTemp->millisToWaitForConversion(dallasTemp->getResolution());
     Homie.getLogger() << cIndent << F("Found ") << dallasTemp->getDS18Count() << " sensors." << endl
                       << cIndent << F("Reading interval: ") << _measurementInterval << " s" << endl;
   }
@@ -26,10 +26,11 @@ private:
 
   int _sensorPin = DEFAULTPIN;
   bool _sensorFound = false;
-  unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
+  unsigned long _conversionStart = 0;
+  unsigned long _conversionTime = 750; // in milliseconds, 12 bit resolution
 
   float temperature = NAN;
+  float _rawTemperature = NAN; // Read by sample(), processed by collect()
 
   OneWire *oneWire;
   DallasTemperature *dallasTemp;
@@ -40,6 +41,8 @@ private:
 
 protected:
   virtual void setup() override;
+  virtual void acquire() override;
+  virtual unsigned long untilAcquire() override;
   virtual void loop() override;
   virtual void onReadyToOperate() override;
 
@@ -49,5 +52,10 @@ public:
                        const int sensorPin = DEFAULTPIN,
                        const int measurementInterval = MEASUREMENT_INTERVAL);
 
+  virtual void start() override;
+  virtual bool ready() override;
+  virtual void sample() override;
+  virtual void collect() override;
+
   float getTemperature() const { return temperature; }
 };
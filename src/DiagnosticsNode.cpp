@@ -0,0 +1,246 @@
+/*
+ * DiagnosticsNode.cpp
+ * Homie Node that samples the free heap, the largest free block, the heap
+ * fragmentation and the free stack, and attributes the heap changes to the
+ * nodes whose loop() or send was running.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "DiagnosticsNode.hpp"
+
+DiagnosticsNode::DiagnosticsNode(const char *id, const char *name, unsigned long sampleInterval, unsigned long publishInterval)
+    : SensorNode(id, name, "Diagnostics"),
+      _publishInterval(publishInterval)
+{
+  _measurementInterval = sampleInterval;
+  asprintf(&_caption, cCaption, name);
+
+  advertise(cFreeHeapTopic)
+      .setDatatype("integer")
+      .setUnit("B");
+  advertise(cMaxBlockTopic)
+      .setDatatype("integer")
+      .setUnit("B");
+  advertise(cFragmentationTopic)
+      .setDatatype("integer")
+      .setFormat("0:100")
+      .setUnit(cUnitPercent);
+  advertise(cFreeStackTopic)
+      .setDatatype("integer")
+      .setUnit("B");
+  advertise(cHeapTrendTopic)
+      .setDatatype("float")
+      .setUnit("B/h");
+  HomieNode::advertise(cHeapNodesTopic)
+      .setDatatype("string")
+      .setFormat("node:loop/send[B],other[B]");
+}
+
+uint32_t DiagnosticsNode::freeHeap()
+{
+  return ESP.getFreeHeap();
+}
+
+uint32_t DiagnosticsNode::maxBlock()
+{
+#ifdef ESP32
+  return ESP.getMaxAllocHeap();
+#else
+  return ESP.getMaxFreeBlockSize();
+#endif
+}
+
+uint8_t DiagnosticsNode::fragmentation()
+{
+#ifdef ESP32
+  // Same definition as on the ESP8266: 0% = the free heap is one block
+  uint32_t free = freeHeap();
+  return (free > 0) ? 100 - (uint64_t)maxBlock() * 100 / free : 0;
+#else
+  return ESP.getHeapFragmentation();
+#endif
+}
+
+uint32_t DiagnosticsNode::freeStack()
+{
+  // The lowest free stack of the loop since boot
+#ifdef ESP32
+  return uxTaskGetStackHighWaterMark(NULL);
+#else
+  return ESP.getFreeContStack();
+#endif
+}
+
+float DiagnosticsNode::heapTrend()
+{
+  if (_trendCount < 2)
+  {
+    return NAN;
+  }
+
+  // Least squares fit of the free heap over the sample number, oldest sample first
+  uint8_t first = (_trendCount < TREND_SAMPLES) ? 0 : _trendNext;
+  float sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+  for (uint8_t i = 0; i < _trendCount; i++)
+  {
+    float y = (float)_trend[(first + i) % TREND_SAMPLES] - (float)_baseline;
+    sumX += i;
+    sumY += y;
+    sumXY += i * y;
+    sumXX += (float)i * i;
+  }
+  float slope = (_trendCount * sumXY - sumX * sumY) / (_trendCount * sumXX - sumX * sumX);
+  // Bytes per sample to bytes per hour
+  return slope * 3600.0f / _measurementInterval;
+}
+
+void DiagnosticsNode::sampleHeap()
+{
+  uint32_t free = freeHeap();
+  uint32_t block = maxBlock();
+  uint8_t fragments = fragmentation();
+  uint32_t stack = freeStack();
+
+  if (free < _minFreeHeap)
+  {
+    _minFreeHeap = free;
+  }
+  if (block < _minMaxBlock)
+  {
+    _minMaxBlock = block;
+  }
+  if (fragments > _maxFragmentation)
+  {
+    _maxFragmentation = fragments;
+  }
+  if (stack < _minFreeStack)
+  {
+    _minFreeStack = stack;
+  }
+
+  _trend[_trendNext] = free;
+  _trendNext = (_trendNext + 1) % TREND_SAMPLES;
+  if (_trendCount < TREND_SAMPLES)
+  {
+    _trendCount++;
+  }
+}
+
+void DiagnosticsNode::send()
+{
+  PROFILE_PHASE(PHASE_SEND);
+  float trend = heapTrend();
+
+  printCaption();
+  Homie.getLogger() << cIndent << F("Free heap: ") << _minFreeHeap << F(" B, largest block: ") << _minMaxBlock
+                    << F(" B, fragmentation: ") << _maxFragmentation << F(" %, free stack: ") << _minFreeStack << F(" B") << endl;
+
+  publish(cFreeHeapTopic, (long)_minFreeHeap);
+  publish(cMaxBlockTopic, (long)_minMaxBlock);
+  publish(cFragmentationTopic, (long)_maxFragmentation);
+  publish(cFreeStackTopic, (long)_minFreeStack);
+  if (!isnan(trend))
+  {
+    publish(cHeapTrendTopic, trend);
+  }
+  publishBatch();
+
+  // The next period starts with the next sample
+  _minFreeHeap = 0xFFFFFFFF;
+  _minMaxBlock = 0xFFFFFFFF;
+  _maxFragmentation = 0;
+  _minFreeStack = 0xFFFFFFFF;
+
+  _reportPending = true;
+}
+
+void DiagnosticsNode::sendReport()
+{
+  // e.g. "bme280:0/412,relay:24/96,other:-380"
+  char buffer[MAX_REPORT_LENGTH];
+  // The nodes may only fill the buffer up to the room for the end, e.g. "...,other:-2147483648"
+  const size_t nodesSize = sizeof(buffer) - MAX_OTHER_LENGTH;
+  size_t pos = 0;
+  int32_t attributed = 0;
+  bool truncated = false;
+  for (SensorNode *node = _first; node; node = node->_next)
+  {
+    // Nodes that are left out of the list are still not counted as other
+    const NodeStats &stats = node->getStats();
+    attributed += stats.heapLoop + stats.heapSend;
+    if (truncated)
+    {
+      continue;
+    }
+    int length = snprintf(buffer + pos, nodesSize - pos, "%s:%ld/%ld,", node->getId(),
+                          (long)stats.heapLoop, (long)stats.heapSend);
+    // Stop at the last complete node instead of cutting a number
+    if ((length > 0) && ((size_t)length < nodesSize - pos))
+    {
+      pos += length;
+    }
+    else
+    {
+      truncated = true;
+    }
+  }
+
+  // Allocated by Homie, the network stack and the sketch outside of the node loops
+  int32_t other = (int32_t)(_baseline - freeHeap()) - attributed;
+  snprintf(buffer + pos, sizeof(buffer) - pos, truncated ? "...,other:%ld" : "other:%ld", (long)other);
+  sendProperty(cHeapNodesTopic, buffer);
+}
+
+void DiagnosticsNode::collect()
+{
+  sampleHeap();
+  countSample(true);
+  _lastMeasurement = NodeClock::now();
+
+  if (isDue(_lastPublish, _publishInterval * 1000UL))
+  {
+    send();
+    _lastPublish = NodeClock::now();
+  }
+}
+
+void DiagnosticsNode::acquire()
+{
+  runMeasurement(isMeasurementDue());
+}
+
+unsigned long DiagnosticsNode::untilAcquire()
+{
+  return untilMeasurement();
+}
+
+unsigned long DiagnosticsNode::nextDeadline()
+{
+  return (_reportPending && canSend()) ? 0 : SensorNode::nextDeadline();
+}
+
+void DiagnosticsNode::loop()
+{
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+
+  if (_reportPending && canSend())
+  {
+    sendReport();
+    _reportPending = false;
+  }
+}
+
+void DiagnosticsNode::setup()
+{
+  printCaption();
+  Homie.getLogger() << cIndent << F("Sample interval: ") << _measurementInterval << F(" s, publish interval: ")
+                    << _publishInterval << F(" s") << endl;
+
+  // From here on, the heap changes in the loops and sends of all nodes are counted
+  _baseline = freeHeap();
+  _trackHeap = true;
+}
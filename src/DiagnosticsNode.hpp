@@ -0,0 +1,69 @@
+/*
+ * DiagnosticsNode.hpp
+ * Homie Node that samples the free heap, the largest free block, the heap
+ * fragmentation and the free stack, and attributes the heap changes to the
+ * nodes whose loop() or send was running.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include "SensorNode.hpp"
+#include "constants.hpp"
+
+class DiagnosticsNode : public SensorNode
+{
+private:
+  static const int SAMPLE_INTERVAL = 60;   // Seconds between two samples
+  static const int PUBLISH_INTERVAL = 900; // Seconds between two publishes
+  static const int TREND_SAMPLES = 64;     // The trend is computed over the last 64 samples
+  static const int MAX_REPORT_LENGTH = 384;
+  static const int MAX_OTHER_LENGTH = 22;  // "...,other:-2147483648" and the terminator
+
+  const char *cCaption = "• %s diagnostics:";
+
+  unsigned long _publishInterval;
+  unsigned long _lastPublish = 0;
+  bool _reportPending = false;
+
+  // Extremes since the last publish
+  uint32_t _minFreeHeap = 0xFFFFFFFF;
+  uint32_t _minMaxBlock = 0xFFFFFFFF;
+  uint8_t _maxFragmentation = 0;
+  uint32_t _minFreeStack = 0xFFFFFFFF;
+
+  uint32_t _baseline = 0; // Free heap after setup()
+  uint32_t _trend[TREND_SAMPLES];
+  uint8_t _trendCount = 0;
+  uint8_t _trendNext = 0;
+
+  static uint32_t freeHeap();
+  static uint32_t maxBlock();
+  static uint8_t fragmentation();
+  static uint32_t freeStack();
+
+  float heapTrend();
+  // Runs in collect(), so that the stack of the Homie loop is measured, even with an acquisition task
+  void sampleHeap();
+  void send();
+  void sendReport();
+
+protected:
+  virtual void setup() override;
+  virtual void acquire() override;
+  virtual unsigned long untilAcquire() override;
+  virtual unsigned long nextDeadline() override;
+  virtual void loop() override;
+
+public:
+  // Samples every <sampleInterval> seconds, publishes the extremes and the
+  // trend every <publishInterval> seconds.
+  explicit DiagnosticsNode(const char *id = "diagnostics",
+                           const char *name = "Diagnostics",
+                           unsigned long sampleInterval = SAMPLE_INTERVAL,
+                           unsigned long publishInterval = PUBLISH_INTERVAL);
+
+  virtual void collect() override;
+};
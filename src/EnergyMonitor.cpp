@@ -0,0 +1,148 @@
+/*
+ * EnergyMonitor.cpp
+ * Counts the radio-on time, publishes, sensor-active and CPU time of each
+ * node and estimates the charge per day from a current-draw profile.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "EnergyMonitor.hpp"
+#include "NodeClock.hpp"
+
+// ESP8266: ~70mA with the radio listening, ~15mA in modem sleep,
+// ~170mA for ~2ms to transmit a short message. 1.5mA for a sensor is a guess
+// between a BME280 (<1mA) and a DS18B20 (1.5mA).
+const EnergyMonitor::PowerProfile EnergyMonitor::DEFAULT_PROFILE = {70.0, 15.0, 10.0, 0.34, 1.5, 0};
+
+EnergyMonitor *EnergyMonitor::active = NULL;
+
+EnergyMonitor::EnergyMonitor()
+    : _start(NodeClock::now()),
+      _radioChange(_start)
+{
+}
+
+EnergyMonitor::Entry *EnergyMonitor::findEntry(const char *node)
+{
+  for (uint8_t i = 0; i < _entryCount; i++)
+  {
+    if ((_entries[i].node == node) || !strcmp(_entries[i].node, node))
+    {
+      return &_entries[i];
+    }
+  }
+  if (_entryCount < MAX_NODES)
+  {
+    _entries[_entryCount] = {node, 0, 0, 0, NAN};
+    return &_entries[_entryCount++];
+  }
+  return NULL;
+}
+
+void EnergyMonitor::published(const char *node)
+{
+  Entry *entry = findEntry(node);
+  if (entry)
+  {
+    entry->publishes++;
+  }
+}
+
+void EnergyMonitor::sensorActive(const char *node, uint32_t milliseconds)
+{
+  Entry *entry = findEntry(node);
+  if (entry)
+  {
+    entry->sensorTime += milliseconds;
+  }
+}
+
+void EnergyMonitor::cpu(const char *node, uint32_t microseconds)
+{
+  Entry *entry = findEntry(node);
+  if (entry)
+  {
+    entry->cpuTime += microseconds;
+  }
+}
+
+void EnergyMonitor::radio(bool on)
+{
+  if (on != _radioOn)
+  {
+    unsigned long now = NodeClock::now();
+    if (_radioOn)
+    {
+      _radioOnTime += now - _radioChange;
+    }
+    _radioOn = on;
+    _radioChange = now;
+  }
+}
+
+uint32_t EnergyMonitor::radioOnTime()
+{
+  return _radioOn ? _radioOnTime + (NodeClock::now() - _radioChange) : _radioOnTime;
+}
+
+void EnergyMonitor::setSensorCurrent(const char *node, float current)
+{
+  Entry *entry = findEntry(node);
+  if (entry)
+  {
+    entry->sensorCurrent = current;
+  }
+}
+
+void EnergyMonitor::report(Print &out, const PowerProfile &profile)
+{
+  unsigned long elapsed = NodeClock::now() - _start;
+  if (elapsed == 0)
+  {
+    elapsed = 1;
+  }
+  // mAs over <elapsed> ms to mAh per day
+  const float perDay = 86400000.0 / elapsed / 3600.0;
+
+  out.printf("Energy over %lus:\n", elapsed / 1000UL);
+  out.printf("%-12s %8s %10s %10s %10s\n", "node", "msgs", "sensor[ms]", "cpu[ms]", "mAh/day");
+
+  float total = 0;
+  for (uint8_t i = 0; i < _entryCount; i++)
+  {
+    const Entry &entry = _entries[i];
+    float sensorCurrent = isnan(entry.sensorCurrent) ? profile.sensorCurrent : entry.sensorCurrent;
+    float charge = entry.publishes * profile.publishCharge +
+                   entry.sensorTime / 1000.0 * sensorCurrent +
+                   entry.cpuTime / 1000000.0 * profile.cpuCurrent;
+    total += charge;
+    out.printf("%-12s %8lu %10lu %10lu %10.2f\n", entry.node, (unsigned long)entry.publishes,
+               (unsigned long)entry.sensorTime, (unsigned long)(entry.cpuTime / 1000), charge * perDay);
+  }
+
+  uint32_t radioOn = radioOnTime();
+  float base = radioOn / 1000.0 * profile.radioCurrent + (elapsed - radioOn) / 1000.0 * profile.sleepCurrent;
+  total += base;
+  out.printf("radio on %lus (%u%%), base %.2f mAh/day\n", (unsigned long)(radioOn / 1000UL),
+             (unsigned int)((uint64_t)radioOn * 100 / elapsed), base * perDay);
+  out.printf("total %.2f mAh/day\n", total * perDay);
+  if (profile.batteryCapacity > 0)
+  {
+    out.printf("battery life %.1f days\n", profile.batteryCapacity / (total * perDay));
+  }
+}
+
+void EnergyMonitor::reset()
+{
+  // Keeps the nodes and their sensor currents
+  for (uint8_t i = 0; i < _entryCount; i++)
+  {
+    _entries[i].publishes = 0;
+    _entries[i].sensorTime = 0;
+    _entries[i].cpuTime = 0;
+  }
+  _start = NodeClock::now();
+  _radioChange = _start;
+  _radioOnTime = 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * EnergyMonitor.hpp
+ * Counts the radio-on time, publishes, sensor-active and CPU time of each
+ * node and estimates the charge per day from a current-draw profile.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class EnergyMonitor
+{
+public:
+  // Currents in mA, charges in mAs. The defaults are typical for an ESP8266 module.
+  struct PowerProfile
+  {
+    float radioCurrent;    // Radio on, listening
+    float sleepCurrent;    // Radio in modem or light sleep
+    float cpuCurrent;      // Added while the code of a node runs
+    float publishCharge;   // Transmitting one message
+    float sensorCurrent;   // Sensor converting, unless set per node
+    float batteryCapacity; // mAh, 0 = don't estimate the battery life
+  };
+  static const PowerProfile DEFAULT_PROFILE;
+
+private:
+  static const int MAX_NODES = 16;
+
+  struct Entry
+  {
+    const char *node;
+    uint32_t publishes;
+    uint32_t sensorTime; // Milliseconds the sensor was converting
+    uint64_t cpuTime;    // Microseconds in loop()
+    float sensorCurrent; // NAN = the default of the profile
+  };
+
+  unsigned long _start;
+  Entry _entries[MAX_NODES];
+  uint8_t _entryCount = 0;
+  bool _radioOn = true;
+  unsigned long _radioChange; // Last time the radio was switched
+  uint32_t _radioOnTime = 0;  // Milliseconds, up to the last switch
+
+  Entry *findEntry(const char *node);
+  uint32_t radioOnTime();
+
+public:
+  // The monitor all nodes report to. NULL = off
+  static EnergyMonitor *active;
+
+  EnergyMonitor();
+
+  void published(const char *node);
+  void sensorActive(const char *node, uint32_t milliseconds);
+  void cpu(const char *node, uint32_t microseconds);
+  void radio(bool on);
+
+  // Overrides the sensor current of the profile for one node
+  void setSensorCurrent(const char *node, float current);
+
+  void report(Print &out, const PowerProfile &profile = DEFAULT_PROFILE);
+  void reset();
+};
@@ -0,0 +1,224 @@
+/*
+ * GorillaBlock.cpp
+ * Fixed size block of timestamped float values, compressed with
+ * delta-of-delta timestamps and XOR encoded values like in Facebook's Gorilla.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "GorillaBlock.hpp"
+
+// Encoding of each value after the first one, most significant bit first:
+//
+// Timestamp: delta of delta in seconds
+//   '0'                     dod == 0
+//   '10'   + 7 bits         dod in [-64, 63]
+//   '110'  + 9 bits         dod in [-256, 255]
+//   '1110' + 12 bits        dod in [-2048, 2047]
+//   '1111' + 32 bits        otherwise
+//
+// Value: XOR with the previous value
+//   '0'                     identical
+//   '10' + meaningful bits  fits into the previous leading/trailing zero window
+//   '11' + 5 bits leading zeros + 5 bits (length - 1) + meaningful bits
+//
+// The first value is stored with 32 bits, the first timestamp in the header.
+
+static const uint16_t MAX_SAMPLE_BITS = 4 + 32 + 2 + 5 + 5 + 32;
+
+static uint32_t floatToBits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float bitsToFloat(uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void GorillaBlock::clear()
+{
+  memset(&_raw, 0, sizeof(_raw));
+  _delta = 0;
+  _value = 0;
+  _leading = 0xFF; // No window yet
+  _trailing = 0;
+}
+
+void GorillaBlock::writeBits(uint32_t value, uint8_t count)
+{
+  while (count > 0)
+  {
+    count--;
+    if (value & (1UL << count))
+    {
+      _raw.data[_raw.header.bits / 8] |= 0x80 >> (_raw.header.bits % 8);
+    }
+    _raw.header.bits++;
+  }
+}
+
+bool GorillaBlock::append(uint32_t time, float value)
+{
+  if ((_raw.header.bits + MAX_SAMPLE_BITS > DATA_SIZE * 8) || (_raw.header.count == 0xFFFF))
+  {
+    return false;
+  }
+
+  uint32_t bits = floatToBits(value);
+  if (_raw.header.count == 0)
+  {
+    _raw.header.firstTime = time;
+    _raw.header.lastTime = time;
+    writeBits(bits, 32);
+    _value = bits;
+    _raw.header.count++;
+    return true;
+  }
+
+  int32_t delta = time - _raw.header.lastTime;
+  int32_t dod = delta - _delta;
+  if (dod == 0)
+  {
+    writeBits(0, 1);
+  }
+  else if ((dod >= -64) && (dod <= 63))
+  {
+    writeBits(0x02, 2);
+    writeBits(dod, 7);
+  }
+  else if ((dod >= -256) && (dod <= 255))
+  {
+    writeBits(0x06, 3);
+    writeBits(dod, 9);
+  }
+  else if ((dod >= -2048) && (dod <= 2047))
+  {
+    writeBits(0x0E, 4);
+    writeBits(dod, 12);
+  }
+  else
+  {
+    writeBits(0x0F, 4);
+    writeBits(dod, 32);
+  }
+  _delta = delta;
+  _raw.header.lastTime = time;
+
+  uint32_t xored = bits ^ _value;
+  if (xored == 0)
+  {
+    writeBits(0, 1);
+  }
+  else
+  {
+    uint8_t leading = __builtin_clz(xored);
+    uint8_t trailing = __builtin_ctz(xored);
+    if (leading > 31)
+    {
+      leading = 31;
+    }
+    if ((_leading != 0xFF) && (leading >= _leading) && (trailing >= _trailing))
+    {
+      writeBits(0x02, 2);
+      writeBits(xored >> _trailing, 32 - _leading - _trailing);
+    }
+    else
+    {
+      uint8_t length = 32 - leading - trailing;
+      writeBits(0x03, 2);
+      writeBits(leading, 5);
+      writeBits(length - 1, 5);
+      writeBits(xored >> trailing, length);
+      _leading = leading;
+      _trailing = trailing;
+    }
+  }
+  _value = bits;
+  _raw.header.count++;
+  return true;
+}
+
+GorillaBlock::Reader::Reader(const uint8_t *block)
+    : _header((const Header *)block),
+      _data(block + sizeof(Header)),
+      _time(_header->firstTime)
+{
+}
+
+uint32_t GorillaBlock::Reader::readBits(uint8_t count)
+{
+  uint32_t value = 0;
+  while (count > 0)
+  {
+    value = (value << 1) | ((_data[_bitPos / 8] >> (7 - _bitPos % 8)) & 1);
+    _bitPos++;
+    count--;
+  }
+  return value;
+}
+
+// Sign extend a value of <count> bits
+static int32_t signExtend(uint32_t value, uint8_t count)
+{
+  return (count < 32) && (value & (1UL << (count - 1))) ? (int32_t)(value | (0xFFFFFFFFUL << count)) : (int32_t)value;
+}
+
+bool GorillaBlock::Reader::next(uint32_t &time, float &value)
+{
+  if (_index >= _header->count)
+  {
+    return false;
+  }
+
+  if (_index == 0)
+  {
+    _value = readBits(32);
+  }
+  else
+  {
+    int32_t dod = 0;
+    if (readBits(1))
+    {
+      if (!readBits(1))
+      {
+        dod = signExtend(readBits(7), 7);
+      }
+      else if (!readBits(1))
+      {
+        dod = signExtend(readBits(9), 9);
+      }
+      else if (!readBits(1))
+      {
+        dod = signExtend(readBits(12), 12);
+      }
+      else
+      {
+        dod = (int32_t)readBits(32);
+      }
+    }
+    _delta += dod;
+    _time += _delta;
+
+    if (readBits(1))
+    {
+      if (readBits(1))
+      {
+        _leading = readBits(5);
+        uint8_t length = readBits(5) + 1;
+        _trailing = 32 - _leading - length;
+      }
+      _value ^= readBits(32 - _leading - _trailing) << _trailing;
+    }
+  }
+
+  _index++;
+  time = _time;
+  value = bitsToFloat(_value);
+  return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * GorillaBlock.hpp
+ * Fixed size block of timestamped float values, compressed with
+ * delta-of-delta timestamps and XOR encoded values like in Facebook's Gorilla.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class GorillaBlock
+{
+public:
+  static const uint16_t SIZE = 128; // Bytes including the header
+
+  struct __attribute__((packed)) Header
+  {
+    uint32_t firstTime; // Seconds
+    uint32_t lastTime;
+    uint16_t count;     // Number of values
+    uint16_t bits;      // Number of used bits in data
+  };
+
+  static const uint16_t DATA_SIZE = SIZE - sizeof(Header);
+
+  // Decodes the values of a block, e.g. one that was read back from flash
+  class Reader
+  {
+  private:
+    const Header *_header;
+    const uint8_t *_data;
+    uint16_t _bitPos = 0;
+    uint16_t _index = 0;
+    uint32_t _time;
+    int32_t _delta = 0;
+    uint32_t _value = 0;
+    uint8_t _leading = 0;
+    uint8_t _trailing = 0;
+
+    uint32_t readBits(uint8_t count);
+
+  public:
+    // <block> points to SIZE bytes: the header followed by the data
+    explicit Reader(const uint8_t *block);
+    bool next(uint32_t &time, float &value);
+  };
+
+private:
+  struct __attribute__((packed)) Raw
+  {
+    Header header;
+    uint8_t data[DATA_SIZE];
+  };
+
+  Raw _raw;
+  int32_t _delta;
+  uint32_t _value;
+  uint8_t _leading;
+  uint8_t _trailing;
+
+  void writeBits(uint32_t value, uint8_t count);
+
+public:
+  GorillaBlock() { clear(); }
+
+  void clear();
+  // Returns false if the block is full
+  bool append(uint32_t time, float value);
+
+  bool isEmpty() const { return _raw.header.count == 0; }
+  const Header &header() const { return _raw.header; }
+  // The header followed by the data, always SIZE bytes
+  const uint8_t *bytes() const { return (const uint8_t *)&_raw; }
+  // Number of bytes that are actually used
+  uint16_t length() const { return sizeof(Header) + (_raw.header.bits + 7) / 8; }
+};
@@ -0,0 +1,126 @@
+/*
+ * LatencyTrace.cpp
+ * Latency percentiles of the stages a measurement or a command passes
+ * through, from the sensor read or handleInput() to the MQTT publish and its
+ * acknowledgement by the broker.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "LatencyTrace.hpp"
+
+const char *const LatencyTrace::STAGE_NAMES[STAGE_COUNT] = {
+    "read", "queue", "send", "ack", "sample", "gpio", "publish", "log", "command"};
+
+uint8_t LatencyTrace::bucket(uint32_t microseconds)
+{
+  if (microseconds < 2 * SUB_BUCKETS)
+  {
+    return microseconds;
+  }
+  // Bucket = (octave - 1) * 4 + the next two bits after the highest set bit
+  uint8_t octave = 31 - __builtin_clz(microseconds);
+  uint32_t index = (octave - 1) * SUB_BUCKETS + ((microseconds >> (octave - 2)) & (SUB_BUCKETS - 1));
+  return (index < BUCKETS) ? index : BUCKETS - 1;
+}
+
+uint32_t LatencyTrace::upperBound(uint8_t bucket)
+{
+  if (bucket < 2 * SUB_BUCKETS - 1)
+  {
+    return bucket;
+  }
+  // The lower bound of the next bucket, minus one
+  uint8_t next = bucket + 1;
+  uint8_t octave = next / SUB_BUCKETS + 1;
+  return ((uint32_t)(SUB_BUCKETS + next % SUB_BUCKETS) << (octave - 2)) - 1;
+}
+
+void LatencyTrace::record(Stage stage, uint32_t microseconds)
+{
+  Histogram &histogram = _histograms[stage];
+  uint16_t &count = histogram.buckets[bucket(microseconds)];
+  if (count < 0xFFFF)
+  {
+    count++;
+  }
+  histogram.count++;
+  if (microseconds > histogram.max)
+  {
+    histogram.max = microseconds;
+  }
+}
+
+void LatencyTrace::sent(uint16_t packetId, uint32_t time)
+{
+  // Overwrites the oldest packet, if the broker didn't acknowledge it in time
+  _pending[_nextPending] = {packetId, time};
+  _nextPending = (_nextPending + 1) % MAX_PENDING;
+}
+
+bool LatencyTrace::acknowledged(uint16_t packetId, uint32_t time)
+{
+  for (uint8_t i = 0; i < MAX_PENDING; i++)
+  {
+    if ((_pending[i].packetId != 0) && (_pending[i].packetId == packetId))
+    {
+      record(STAGE_ACK, time - _pending[i].sent);
+      _pending[i].packetId = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t LatencyTrace::percentile(Stage stage, uint8_t percent) const
+{
+  const Histogram &histogram = _histograms[stage];
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < BUCKETS; i++)
+  {
+    total += histogram.buckets[i];
+  }
+  // The number of values at or below the percentile, rounded up
+  uint32_t rank = (total * percent + 99) / 100;
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < BUCKETS; i++)
+  {
+    sum += histogram.buckets[i];
+    if ((sum >= rank) && (sum > 0))
+    {
+      // The highest bucket is open ended
+      uint32_t bound = (i < BUCKETS - 1) ? upperBound(i) : histogram.max;
+      return (bound < histogram.max) ? bound : histogram.max;
+    }
+  }
+  return histogram.max;
+}
+
+void LatencyTrace::format(char *buffer, size_t size, uint32_t sequence) const
+{
+  size_t pos = 0;
+  buffer[0] = '\0';
+  for (uint8_t i = 0; i < STAGE_COUNT; i++)
+  {
+    Stage stage = (Stage)i;
+    if (_histograms[i].count > 0)
+    {
+      int length = snprintf(buffer + pos, size - pos, "%s:%lu/%lu/%lu/%lu,", STAGE_NAMES[i],
+                            (unsigned long)percentile(stage, 50), (unsigned long)percentile(stage, 90),
+                            (unsigned long)percentile(stage, 99), (unsigned long)_histograms[i].max);
+      // Leave out the whole stage instead of cutting a number
+      if ((length > 0) && ((size_t)length < size - pos))
+      {
+        pos += length;
+      }
+      buffer[pos] = '\0';
+    }
+  }
+  snprintf(buffer + pos, size - pos, "seq:%lu,skipped:%lu", (unsigned long)sequence, (unsigned long)_skipped);
+}
+
+void LatencyTrace::reset()
+{
+  memset(_histograms, 0, sizeof(_histograms));
+}
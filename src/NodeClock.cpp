@@ -0,0 +1,12 @@
+/*
+ * NodeClock.cpp
+ * Time source for all nodes. Defaults to millis(), a VirtualClock can be
+ * injected to simulate long periods of time in a fraction of it.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "NodeClock.hpp"
+
+NodeClock *NodeClock::active = NULL;
@@ -0,0 +1,39 @@
+/*
+ * NodeClock.hpp
+ * Time source for all nodes. Defaults to millis(), a VirtualClock can be
+ * injected to simulate long periods of time in a fraction of it.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class NodeClock
+{
+public:
+  // The clock all nodes use. NULL = millis()
+  static NodeClock *active;
+
+  static unsigned long now() { return active ? active->millis() : ::millis(); }
+
+  virtual ~NodeClock() {}
+  virtual unsigned long millis() = 0;
+};
+
+// A clock that only moves when it is told to. Start it shortly before
+// 0xFFFFFFFF to test the millis() wraparound after 49.7 days.
+class VirtualClock : public NodeClock
+{
+private:
+  unsigned long _now;
+
+public:
+  explicit VirtualClock(unsigned long start = 0) : _now(start) {}
+
+  virtual unsigned long millis() override { return _now; }
+  void set(unsigned long now) { _now = now; }
+  void advance(unsigned long ms) { _now += ms; }
+};
@@ -0,0 +1,264 @@
+/*
+ * NodeHistory.cpp
+ * Long-term history of the float properties of a node in LittleFS.
+ * Raw values, 5 minute and hourly averages are stored in compressed blocks
+ * and can be queried by the controller.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "NodeHistory.hpp"
+#include "NodeClock.hpp"
+
+#include <LittleFS.h>
+#include <time.h>
+
+const uint32_t NodeHistory::TIER_SECONDS[TIER_COUNT] = {0, 300, 3600};
+// Each tier keeps the current and the previous file, so up to twice this size
+const uint32_t NodeHistory::MAX_FILE_SIZE[TIER_COUNT] = {64 * 1024, 32 * 1024, 16 * 1024};
+
+static const char cBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const uint32_t cValidTime = 1577836800; // 2020-01-01
+
+uint32_t NodeHistory::now()
+{
+  time_t t = time(nullptr);
+  return (t > (time_t)cValidTime) ? (uint32_t)t : NodeClock::now() / 1000UL;
+}
+
+NodeHistory::NodeHistory(const char *nodeId)
+    : _nodeId(nodeId)
+{
+}
+
+bool NodeHistory::addChannel(uint8_t index, const char *property)
+{
+  if (_channelCount >= MAX_CHANNELS)
+  {
+    return false;
+  }
+  Channel *channel = new Channel();
+  channel->index = index;
+  channel->property = property;
+  _channels[_channelCount++] = channel;
+  return true;
+}
+
+void NodeHistory::fileName(char *buffer, size_t size, const Channel &channel, uint8_t tier, bool old)
+{
+  // e.g. "/bme280.12" for the 5 minute averages of the second property
+  snprintf(buffer, size, "/%s.%u%u%s", _nodeId, channel.index, tier, old ? "o" : "");
+}
+
+void NodeHistory::add(uint8_t index, float value)
+{
+  Channel *channel = NULL;
+  for (uint8_t i = 0; i < _channelCount; i++)
+  {
+    if (_channels[i]->index == index)
+    {
+      channel = _channels[i];
+    }
+  }
+  if (!channel)
+  {
+    return;
+  }
+
+  uint32_t time = now();
+  append(*channel, TIER_RAW, time, value);
+
+  // The averages are rolled up with each value, the raw values are not read back
+  for (uint8_t tier = TIER_5MIN; tier < TIER_COUNT; tier++)
+  {
+    TierState &state = channel->tiers[tier];
+    uint32_t bucket = time - time % TIER_SECONDS[tier];
+    if ((state.count > 0) && (bucket != state.bucket))
+    {
+      append(*channel, tier, state.bucket, state.sum / state.count);
+      state.sum = 0;
+      state.count = 0;
+    }
+    state.bucket = bucket;
+    state.sum += value;
+    state.count++;
+  }
+}
+
+void NodeHistory::append(Channel &channel, uint8_t tier, uint32_t time, float value)
+{
+  GorillaBlock &block = channel.tiers[tier].block;
+  if (!block.append(time, value))
+  {
+    store(channel, tier);
+    block.clear();
+    block.append(time, value);
+  }
+}
+
+void NodeHistory::store(Channel &channel, uint8_t tier)
+{
+  char name[32];
+  char oldName[32];
+  fileName(name, sizeof(name), channel, tier, false);
+  fileName(oldName, sizeof(oldName), channel, tier, true);
+
+  File file = LittleFS.open(name, "a");
+  if (file && (file.size() + GorillaBlock::SIZE > MAX_FILE_SIZE[tier]))
+  {
+    // Full: the current file becomes the previous one
+    file.close();
+    LittleFS.remove(oldName);
+    LittleFS.rename(name, oldName);
+    file = LittleFS.open(name, "a");
+  }
+  if (file)
+  {
+    // Blocks are always written with their full size, so they can be found by position
+    file.write(channel.tiers[tier].block.bytes(), GorillaBlock::SIZE);
+    file.close();
+  }
+}
+
+bool NodeHistory::query(const char *request)
+{
+  const char *comma = strchr(request, ',');
+  if (!comma)
+  {
+    return false;
+  }
+
+  Channel *channel = NULL;
+  size_t length = comma - request;
+  for (uint8_t i = 0; i < _channelCount; i++)
+  {
+    if ((strncmp(_channels[i]->property, request, length) == 0) && (_channels[i]->property[length] == '\0'))
+    {
+      channel = _channels[i];
+    }
+  }
+
+  char *end;
+  unsigned long tier = strtoul(comma + 1, &end, 10);
+  if (!channel || (end == comma + 1) || (*end != ',') || (tier >= TIER_COUNT))
+  {
+    return false;
+  }
+
+  _query.channel = channel;
+  _query.tier = tier;
+  _query.from = strtoul(end + 1, &end, 10);
+  _query.to = (*end == ',') ? strtoul(end + 1, NULL, 10) : 0xFFFFFFFF;
+  _query.source = SOURCE_OLD_FILE;
+  _query.position = 0;
+  _query.chunks = 0;
+  return true;
+}
+
+bool NodeHistory::readBlock(uint8_t *block)
+{
+  char name[32];
+  fileName(name, sizeof(name), *_query.channel, _query.tier, _query.source == SOURCE_OLD_FILE);
+
+  bool read = false;
+  File file = LittleFS.open(name, "r");
+  if (file)
+  {
+    read = (_query.position + GorillaBlock::SIZE <= file.size()) &&
+           file.seek(_query.position) &&
+           (file.read(block, GorillaBlock::SIZE) == GorillaBlock::SIZE);
+    file.close();
+  }
+  _query.position += GorillaBlock::SIZE;
+  return read;
+}
+
+bool NodeHistory::overlaps(const uint8_t *block)
+{
+  const GorillaBlock::Header *header = (const GorillaBlock::Header *)block;
+  return (header->count > 0) && (header->lastTime >= _query.from) && (header->firstTime <= _query.to);
+}
+
+void NodeHistory::formatChunk(char *buffer, size_t size, const uint8_t *block, uint16_t length)
+{
+  size_t pos = snprintf(buffer, size, "%s,%u,%u,", _query.channel->property, _query.tier, _query.chunks++);
+  for (uint16_t i = 0; (i < length) && (pos + 5 <= size); i += 3)
+  {
+    uint32_t triple = (uint32_t)block[i] << 16;
+    triple |= (i + 1 < length) ? (uint32_t)block[i + 1] << 8 : 0;
+    triple |= (i + 2 < length) ? block[i + 2] : 0;
+    buffer[pos++] = cBase64[(triple >> 18) & 0x3F];
+    buffer[pos++] = cBase64[(triple >> 12) & 0x3F];
+    buffer[pos++] = (i + 1 < length) ? cBase64[(triple >> 6) & 0x3F] : '=';
+    buffer[pos++] = (i + 2 < length) ? cBase64[triple & 0x3F] : '=';
+  }
+  buffer[pos] = '\0';
+}
+
+unsigned long NodeHistory::untilNextChunk()
+{
+  if ((_query.source == SOURCE_DONE) || !_query.channel)
+  {
+    return 0xFFFFFFFFUL;
+  }
+  unsigned long elapsed = NodeClock::now() - _lastChunk;
+  return (elapsed < CHUNK_INTERVAL) ? CHUNK_INTERVAL - elapsed : 0;
+}
+
+bool NodeHistory::nextChunk(char *buffer, size_t size)
+{
+  if ((_query.source == SOURCE_DONE) || !_query.channel ||
+      (NodeClock::now() - _lastChunk < CHUNK_INTERVAL))
+  {
+    return false;
+  }
+
+  uint8_t block[GorillaBlock::SIZE];
+  for (uint8_t i = 0; i < MAX_BLOCKS_PER_CALL; i++)
+  {
+    switch (_query.source)
+    {
+    case SOURCE_OLD_FILE:
+    case SOURCE_FILE:
+      if (readBlock(block))
+      {
+        if (overlaps(block))
+        {
+          const GorillaBlock::Header *header = (const GorillaBlock::Header *)block;
+          formatChunk(buffer, size, block, sizeof(GorillaBlock::Header) + (header->bits + 7) / 8);
+          _lastChunk = NodeClock::now();
+          return true;
+        }
+      }
+      else
+      {
+        _query.source = (QuerySource)(_query.source + 1);
+        _query.position = 0;
+      }
+      break;
+    case SOURCE_RAM:
+    {
+      // The block that is still being filled
+      const GorillaBlock &current = _query.channel->tiers[_query.tier].block;
+      _query.source = SOURCE_END;
+      if (overlaps(current.bytes()))
+      {
+        formatChunk(buffer, size, current.bytes(), current.length());
+        _lastChunk = NodeClock::now();
+        return true;
+      }
+      break;
+    }
+    case SOURCE_END:
+      // e.g. "temperature,1,end,12"
+      snprintf(buffer, size, "%s,%u,end,%u", _query.channel->property, _query.tier, _query.chunks);
+      _query.source = SOURCE_DONE;
+      _lastChunk = NodeClock::now();
+      return true;
+    case SOURCE_DONE:
+      return false;
+    }
+  }
+  return false;
+}
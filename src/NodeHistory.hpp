@@ -0,0 +1,102 @@
+/*
+ * NodeHistory.hpp
+ * Long-term history of the float properties of a node in LittleFS.
+ * Raw values, 5 minute and hourly averages are stored in compressed blocks
+ * and can be queried by the controller.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "GorillaBlock.hpp"
+
+class NodeHistory
+{
+public:
+  enum Tier
+  {
+    TIER_RAW,   // Each measured value
+    TIER_5MIN,  // Average over 5 minutes
+    TIER_HOUR,  // Average over one hour
+    TIER_COUNT
+  };
+
+  // <property>,<tier>,<number>,<base64 encoded block>
+  static const int MAX_CHUNK_LENGTH = 32 + (GorillaBlock::SIZE + 2) / 3 * 4;
+
+private:
+  static const int MAX_CHANNELS = 8;
+  static const int MAX_BLOCKS_PER_CALL = 8; // Limits the flash reads per loop()
+  static const int CHUNK_INTERVAL = 100;    // Publish one chunk every 100ms
+  static const uint32_t TIER_SECONDS[TIER_COUNT];
+  static const uint32_t MAX_FILE_SIZE[TIER_COUNT];
+
+  struct TierState
+  {
+    GorillaBlock block; // Not yet written to flash
+    uint32_t bucket;    // Start of the current averaging period
+    float sum;
+    uint16_t count;
+  };
+
+  struct Channel
+  {
+    uint8_t index; // Index of the property in the node
+    const char *property;
+    TierState tiers[TIER_COUNT];
+  };
+
+  enum QuerySource
+  {
+    SOURCE_OLD_FILE,
+    SOURCE_FILE,
+    SOURCE_RAM,
+    SOURCE_END,
+    SOURCE_DONE
+  };
+
+  struct Query
+  {
+    Channel *channel;
+    uint8_t tier;
+    uint32_t from;
+    uint32_t to;
+    QuerySource source;
+    uint32_t position; // Read position in the file
+    uint16_t chunks;   // Number of chunks sent
+  };
+
+  const char *_nodeId;
+  Channel *_channels[MAX_CHANNELS];
+  uint8_t _channelCount = 0;
+  Query _query = {};
+  unsigned long _lastChunk = 0;
+
+  void fileName(char *buffer, size_t size, const Channel &channel, uint8_t tier, bool old);
+  void append(Channel &channel, uint8_t tier, uint32_t time, float value);
+  void store(Channel &channel, uint8_t tier);
+  bool readBlock(uint8_t *block);
+  bool overlaps(const uint8_t *block);
+  void formatChunk(char *buffer, size_t size, const uint8_t *block, uint16_t length);
+
+public:
+  // Seconds since 1970 if the firmware has set the time, e.g. with configTime(),
+  // otherwise seconds since boot.
+  static uint32_t now();
+
+  explicit NodeHistory(const char *nodeId);
+
+  bool addChannel(uint8_t index, const char *property);
+  void add(uint8_t index, float value);
+
+  // Starts a query, e.g. "temperature,1,1700000000,1700086400". The end is optional.
+  bool query(const char *request);
+  // Returns true and the next chunk of the running query, at most MAX_CHUNK_LENGTH
+  bool nextChunk(char *buffer, size_t size);
+  // Milliseconds until nextChunk() has the next chunk, 0xFFFFFFFF = no query running
+  unsigned long untilNextChunk();
+};
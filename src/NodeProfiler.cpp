@@ -0,0 +1,93 @@
+/*
+ * NodeProfiler.cpp
+ * Optional latency histograms for the loop(), send() and handleInput()
+ * phases of a node and the longest time with interrupts disabled.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "NodeProfiler.hpp"
+
+uint32_t NodeProfiler::ticks()
+{
+  return ESP.getCycleCount();
+}
+
+uint32_t NodeProfiler::ticksPerMicrosecond()
+{
+  return ESP.getCpuFreqMHz();
+}
+
+void NodeProfiler::interruptsOn()
+{
+  uint32_t duration = ticks() - _interruptsOffStart;
+  if (duration > _maxInterruptsOff)
+  {
+    _maxInterruptsOff = duration;
+  }
+}
+
+void NodeProfiler::record(Phase phase, uint32_t duration)
+{
+  Histogram &histogram = _histograms[phase];
+  // Counted in microseconds, so that blocking sensor reads of up to several seconds
+  // land in separate buckets
+  uint32_t us = duration / ticksPerMicrosecond();
+
+  int bucket = 0;
+  while ((us >> bucket) && (bucket < BUCKETS - 1))
+  {
+    bucket++;
+  }
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  if (us > histogram.max)
+  {
+    histogram.max = us;
+  }
+}
+
+void NodeProfiler::print(Print &out, const char *indent) const
+{
+  static const char *cPhaseNames[PHASE_COUNT] = {"loop", "send", "input"};
+  uint32_t tpus = ticksPerMicrosecond();
+
+  for (int phase = 0; phase < PHASE_COUNT; phase++)
+  {
+    const Histogram &histogram = _histograms[phase];
+    if (histogram.count == 0)
+    {
+      continue;
+    }
+    out.printf("%s%s: n=%lu max=%luus\n", indent, cPhaseNames[phase],
+               (unsigned long)histogram.count, (unsigned long)histogram.max);
+    for (int bucket = 0; bucket < BUCKETS; bucket++)
+    {
+      if ((histogram.buckets[bucket] > 0) && (bucket < BUCKETS - 1))
+      {
+        // Upper bound of the bucket
+        out.printf("%s  <%luus: %lu\n", indent, 1UL << bucket, (unsigned long)histogram.buckets[bucket]);
+      }
+      else if (histogram.buckets[bucket] > 0)
+      {
+        // The last bucket is open ended, label it with its lower bound
+        out.printf("%s  >=%luus: %lu\n", indent, 1UL << (bucket - 1), (unsigned long)histogram.buckets[bucket]);
+      }
+    }
+  }
+  // Only the nodes that disable interrupts report it
+  if (_maxInterruptsOff > 0)
+  {
+    out.printf("%sinterrupts off: max=%luus\n", indent, (unsigned long)(_maxInterruptsOff / tpus));
+  }
+}
+
+void NodeProfiler::reset()
+{
+  for (int phase = 0; phase < PHASE_COUNT; phase++)
+  {
+    _histograms[phase] = {};
+  }
+  _maxInterruptsOff = 0;
+}
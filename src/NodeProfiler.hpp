@@ -0,0 +1,82 @@
+/*
+ * NodeProfiler.hpp
+ * Optional latency histograms for the loop(), send() and handleInput()
+ * phases of a node and the longest time with interrupts disabled.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+// Uncomment to enable profiling. Costs ~330 bytes of RAM per node.
+// #define NODE_PROFILER
+
+#include <Arduino.h>
+
+class NodeProfiler
+{
+public:
+  enum Phase
+  {
+    PHASE_LOOP,
+    PHASE_SEND,
+    PHASE_INPUT,
+    PHASE_COUNT
+  };
+
+  // Bucket n counts durations in [2^(n-1) .. 2^n) microseconds, the last one all from
+  // 2^(BUCKETS-2) = 8.4s. Bucket 0 counts everything below 1us.
+  static const int BUCKETS = 25;
+
+  struct Histogram
+  {
+    uint32_t buckets[BUCKETS];
+    uint32_t count;
+    uint32_t max; // Microseconds
+  };
+
+  // Measures the time between construction and destruction
+  class Scope
+  {
+  private:
+    NodeProfiler &_profiler;
+    Phase _phase;
+    uint32_t _start;
+
+  public:
+    Scope(NodeProfiler &profiler, Phase phase) : _profiler(profiler), _phase(phase), _start(ticks()) {}
+    ~Scope() { _profiler.record(_phase, ticks() - _start); }
+  };
+
+private:
+  Histogram _histograms[PHASE_COUNT] = {};
+
+  uint32_t _interruptsOffStart = 0;
+  uint32_t _maxInterruptsOff = 0;
+
+public:
+  static uint32_t ticks();
+  static uint32_t ticksPerMicrosecond();
+
+  // Call directly after noInterrupts() and directly before interrupts()
+  void interruptsOff() { _interruptsOffStart = ticks(); }
+  void interruptsOn();
+  uint32_t getMaxInterruptsOff() const { return _maxInterruptsOff; }
+
+  // <duration> is in ticks. The cycle counter wraps after 2^32 ticks, e.g. 26.8s at 160MHz.
+  void record(Phase phase, uint32_t duration);
+  const Histogram &getHistogram(Phase phase) const { return _histograms[phase]; }
+  void print(Print &out, const char *indent) const;
+  void reset();
+};
+
+#ifdef NODE_PROFILER
+#define PROFILE_PHASE(phase) NodeProfiler::Scope profileScope(_profiler, NodeProfiler::phase)
+#define PROFILE_INTERRUPTS_OFF() _profiler.interruptsOff()
+#define PROFILE_INTERRUPTS_ON() _profiler.interruptsOn()
+#else
+#define PROFILE_PHASE(phase)
+#define PROFILE_INTERRUPTS_OFF()
+#define PROFILE_INTERRUPTS_ON()
+#endif
@@ -0,0 +1,146 @@
+/*
+ * NodeTrace.cpp
+ * Records the raw readings of all nodes into a compact binary trace and
+ * replays them in place of the hardware, e.g. on a host with faked drivers.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "NodeTrace.hpp"
+#include "NodeClock.hpp"
+#include "NodeProfiler.hpp"
+
+NodeTrace *NodeTrace::active = NULL;
+
+uint16_t NodeTrace::hashId(const char *id)
+{
+  // FNV-1a, folded to 16 bits
+  uint32_t hash = 2166136261UL;
+  while (*id)
+  {
+    hash ^= (uint8_t)*id++;
+    hash *= 16777619UL;
+  }
+  return (uint16_t)((hash >> 16) ^ hash);
+}
+
+TraceRecorder::TraceRecorder(Print &out)
+    : _out(out),
+      _start(NodeClock::now())
+{
+}
+
+float TraceRecorder::sample(const char *nodeId, uint8_t channel, float value)
+{
+  uint16_t node = hashId(nodeId);
+  Channel *current = NULL;
+
+  for (uint8_t i = 0; i < _channelCount; i++)
+  {
+    if ((_channels[i].node == node) && (_channels[i].channel == channel))
+    {
+      current = &_channels[i];
+      break;
+    }
+  }
+
+  // Only write changes, digital inputs are read in every loop.
+  // If there are too many channels, the extra ones are written with every reading.
+  if (current)
+  {
+    if ((current->value == value) || (isnan(current->value) && isnan(value)))
+    {
+      return value;
+    }
+    current->value = value;
+  }
+  else if (_channelCount < MAX_CHANNELS)
+  {
+    _channels[_channelCount++] = {node, channel, value};
+  }
+
+  Record record = {(uint32_t)(NodeClock::now() - _start), node, channel, value};
+  _out.write((const uint8_t *)&record, sizeof(record));
+  return value;
+}
+
+TracePlayer::TracePlayer(Stream &in, Print &report)
+    : _in(in),
+      _report(report),
+      _start(NodeClock::now())
+{
+  advance();
+}
+
+void TracePlayer::advance()
+{
+  _hasNext = (_in.readBytes((char *)&_next, sizeof(_next)) == sizeof(_next));
+}
+
+TracePlayer::Channel *TracePlayer::findChannel(uint16_t node, uint8_t channel, bool create)
+{
+  for (uint8_t i = 0; i < _channelCount; i++)
+  {
+    if ((_channels[i].node == node) && (_channels[i].channel == channel))
+    {
+      return &_channels[i];
+    }
+  }
+  if (create && (_channelCount < MAX_CHANNELS))
+  {
+    _channels[_channelCount] = {node, channel, NAN, 0, 0};
+    return &_channels[_channelCount++];
+  }
+  return NULL;
+}
+
+float TracePlayer::sample(const char *nodeId, uint8_t channel, float value)
+{
+  uint32_t now = NodeClock::now() - _start;
+
+  while (_hasNext && (_next.time <= now))
+  {
+    Channel *recorded = findChannel(_next.node, _next.channel, true);
+    if (recorded)
+    {
+      recorded->value = _next.value;
+    }
+    advance();
+  }
+
+  Channel *current = findChannel(hashId(nodeId), channel, false);
+  _samples++;
+  if (!current)
+  {
+    // Nothing recorded (yet) for this channel, keep the live value
+    return value;
+  }
+  current->sampleTicks = NodeProfiler::ticks();
+  current->sampleNumber = _samples;
+  return current->value;
+}
+
+void TracePlayer::published(const char *nodeId, const char *property, const char *value)
+{
+  uint16_t node = hashId(nodeId);
+  Channel *latest = NULL;
+
+  // The processing time runs from the node's latest reading on any channel
+  for (uint8_t i = 0; i < _channelCount; i++)
+  {
+    if ((_channels[i].node == node) && (_channels[i].sampleNumber > 0) &&
+        (!latest || (_channels[i].sampleNumber > latest->sampleNumber)))
+    {
+      latest = &_channels[i];
+    }
+  }
+
+  _publishes++;
+  _report.printf("%lu %s/%s=%s", (unsigned long)(NodeClock::now() - _start), nodeId, property, value);
+  if (latest)
+  {
+    _report.printf(" (%luus)", (unsigned long)((NodeProfiler::ticks() - latest->sampleTicks) / NodeProfiler::ticksPerMicrosecond()));
+  }
+  _report.printf("\n");
+}
@@ -0,0 +1,102 @@
+/*
+ * NodeTrace.hpp
+ * Records the raw readings of all nodes into a compact binary trace and
+ * replays them in place of the hardware, e.g. on a host with faked drivers.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class NodeTrace
+{
+public:
+  struct __attribute__((packed)) Record
+  {
+    uint32_t time;  // milliseconds since the start of the trace
+    uint16_t node;  // hash of the node id
+    uint8_t channel;
+    float value;
+  };
+
+  // The trace every node reports to. NULL = tracing is off
+  static NodeTrace *active;
+
+  static uint16_t hashId(const char *id);
+
+  virtual ~NodeTrace() {}
+
+  // Called with every raw reading of a node. Returns the value the node shall use.
+  virtual float sample(const char *nodeId, uint8_t channel, float value) = 0;
+  // Called with every MQTT publish of a node
+  virtual void published(const char *nodeId, const char *property, const char *value) {}
+};
+
+// Writes a record whenever a raw reading changes
+class TraceRecorder : public NodeTrace
+{
+private:
+  static const int MAX_CHANNELS = 16;
+
+  struct Channel
+  {
+    uint16_t node;
+    uint8_t channel;
+    float value;
+  };
+
+  Print &_out;
+  unsigned long _start;
+  Channel _channels[MAX_CHANNELS];
+  uint8_t _channelCount = 0;
+
+public:
+  explicit TraceRecorder(Print &out);
+
+  virtual float sample(const char *nodeId, uint8_t channel, float value) override;
+};
+
+// Replaces the raw readings with the values from a recorded trace. A reading returns
+// the latest recorded value of its channel at the current time since the start.
+// Publishes are reported with their time and the processing time since the
+// node's last reading.
+class TracePlayer : public NodeTrace
+{
+private:
+  static const int MAX_CHANNELS = 16;
+
+  struct Channel
+  {
+    uint16_t node;
+    uint8_t channel;
+    float value;
+    uint32_t sampleTicks;  // NodeProfiler ticks at the last reading
+    uint32_t sampleNumber; // Running number of the last reading, 0 = not read yet
+  };
+
+  Stream &_in;
+  Print &_report;
+  unsigned long _start;
+  Record _next;
+  bool _hasNext = false;
+  Channel _channels[MAX_CHANNELS];
+  uint8_t _channelCount = 0;
+  uint32_t _samples = 0;
+  uint32_t _publishes = 0;
+
+  Channel *findChannel(uint16_t node, uint8_t channel, bool create);
+  void advance();
+
+public:
+  TracePlayer(Stream &in, Print &report);
+
+  virtual float sample(const char *nodeId, uint8_t channel, float value) override;
+  virtual void published(const char *nodeId, const char *property, const char *value) override;
+
+  bool isFinished() const { return !_hasNext; }
+  uint32_t getSamples() const { return _samples; }
+  uint32_t getPublishes() const { return _publishes; }
+};
@@ -17,7 +17,7 @@ bool checkBounds(float value, float min, float max)
 PingNode::PingNode(const char *id, const char *name, const char *type, const int triggerPin, const int echoPin,
                    const int measurementInterval, const int publishInterval)
     : SensorNode(id, name, type),
-      _triggerPin(triggerPin), _echoPin(echoPin), _lastMeasurement(0), _lastPublish(0)
+      _triggerPin(triggerPin), _echoPin(echoPin), _lastPublish(0)
 {
   _measurementInterval = (measurementInterval > MIN_INTERVAL) ? measurementInterval : MIN_INTERVAL;
   _publishInterval = (publishInterval > int(_measurementInterval)) ? publishInterval : _measurementInterval;
@@ -47,72 +47,111 @@ PingNode::PingNode(const char *id, const char *name, const char *type, const int
 
 void PingNode::send(bool changed)
 {
+  PROFILE_PHASE(PHASE_SEND);
   bool valid = _distance > 0;
   printCaption();
   Homie.getLogger() << cIndent << F("Ping: ") << _ping_us << " " << cUnitMicrosecond << endl;
   Homie.getLogger() << cIndent << F("Distance: ") << _distance << " " << cUnitMeter << endl;
   Homie.getLogger() << cIndent << F("Valid: ") << (valid ? "ok" : "error") << endl;
   Homie.getLogger() << cIndent << F("Changed: ") << (changed ? F("true") : F("false")) << " " << endl;
-  if (Homie.isConnected())
+  publish(cValidTopic, valid ? "ok" : "error");
+  if (valid)
   {
-    setProperty(cValidTopic).send(valid ? "ok" : "error");
-    if (valid)
-    {
-      setProperty(cDistanceTopic).send(String(_distance));
-      setProperty(cPingTopic).send(String(_ping_us));
-      setProperty(cChangedTopic).send(changed ? F("true") : F("false"));
-    }
+    publish(cDistanceTopic, _distance);
+    publish(cPingTopic, (long)_ping_us);
+    publish(cChangedTopic, changed ? F("true") : F("false"));
   }
+  publishBatch();
 }
 
-void PingNode::loop()
+void PingNode::sample()
 {
-  if (sonar)
+  // NewPing's timer based interface is not available on the ESP, so the echo is
+  // measured here and this is the only phase that takes time.
+  _rawEchoTime = sonar->ping_median((uint8_t)'\005', _maxDistance * 100.0);
+}
+
+void PingNode::collect()
+{
+  float ping_us = trace(0, _rawEchoTime);
+  float newDistance = ping_us * _microseconds2meter;
+  fixRange(&newDistance, _minDistance, _maxDistance);
+  countSample(newDistance > 0);
+  if (newDistance > 0)
   {
-    bool changed = false;
-    if (millis() - _lastMeasurement >= _measurementInterval * 1000UL || _lastMeasurement == 0)
+    _ping_us = ping_us;
+    _distance = newDistance;
+    if (signalChange(_distance, _lastDistance))
     {
-      float ping_us = sonar->ping_median((uint8_t)'\005', _maxDistance * 100.0);
-      float newDistance = ping_us * _microseconds2meter;
-      fixRange(&newDistance, _minDistance, _maxDistance);
-      if (newDistance > 0)
+      if (onChange(_distance, _lastDistance))
       {
-        _ping_us = ping_us;
-        _distance = newDistance;
-        changed = signalChange(_distance, _lastDistance);
-        if (changed)
-        {
-          if (onChange(_distance, _lastDistance))
-          {
-            _changeHandler();
-          }
-          _lastDistance = _distance;
-        }
+        _changeHandler();
       }
-      _lastMeasurement = millis();
+      _lastDistance = _distance;
     }
+  }
+  adaptInterval((newDistance > 0) ? newDistance : NAN);
+  _lastMeasurement = NodeClock::now();
+}
+
+void PingNode::loop()
+{
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+}
+
+void PingNode::acquire()
+{
+  if (sonar)
+  {
+    runMeasurement(isMeasurementDue());
 
-    if (millis() - _lastPublish >= _publishInterval * 1000UL || _lastPublish == 0)
+    if (NodeClock::now() - _lastPublish >= _publishInterval * 1000UL || _lastPublish == 0)
     {
       if (_distance > 0)
       {
-        changed = signalChange(_distance, _lastPublishedDistance);
+        bool changed = signalChange(_distance, _lastPublishedDistance);
         send(changed);
         if (changed)
         {
           _lastPublishedDistance = _distance;
+          if (RtcStore::active)
+          {
+            uint32_t bits;
+            memcpy(&bits, &_lastPublishedDistance, sizeof(bits));
+            RtcStore::active->setCounter(getId(), 0, bits);
+          }
         }
-        _lastPublish = millis();
+        _lastPublish = NodeClock::now();
       }
     }
   }
 }
 
+unsigned long PingNode::untilAcquire()
+{
+  if (!sonar)
+  {
+    return TicklessIdle::FOREVER;
+  }
+  return earlier(untilMeasurement(),
+                 (_distance > 0) ? untilElapsed(_lastPublish, _publishInterval * 1000UL) : TicklessIdle::FOREVER);
+}
+
 void PingNode::onReadyToOperate()
 {
-  if (Homie.isConnected())
+  publish(cValidTopic, "ok");
+  SensorNode::onReadyToOperate();
+}
+
+void PingNode::restoreState(RtcStore &store)
+{
+  SensorNode::restoreState(store);
+  uint32_t bits;
+  if (store.getCounter(getId(), 0, bits))
   {
-    setProperty(cValidTopic).send("ok");
+    memcpy(&_lastPublishedDistance, &bits, sizeof(bits));
   }
 }
 
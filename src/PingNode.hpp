@@ -31,14 +31,13 @@ private:
   float _minChange = 0.2;
   float _minDistance = 0.0;
   float _maxDistance = 4.0;
-  unsigned long _measurementInterval;
-  unsigned long _lastMeasurement;
   unsigned long _publishInterval;
   unsigned long _lastPublish;
 
   NewPing *sonar;
   float _distance = NAN;
   int _ping_us = 0;
+  float _rawEchoTime = 0; // Read by sample(), processed by collect()
   float _lastDistance = 0;
   float _lastPublishedDistance = 0;
   ChangeHandler _changeHandler = []() {};
@@ -48,8 +47,11 @@ private:
 
 protected:
   virtual void setup() override;
+  virtual void acquire() override;
+  virtual unsigned long untilAcquire() override;
   virtual void loop() override;
   virtual void onReadyToOperate() override;
+  virtual void restoreState(RtcStore &store) override;
   virtual bool onChange(float newDistance, float prevDistance) { return true; }
   static const int DEFAULT_MEASUREMENT_INTERVAL = 1;
   static const int DEFAULT_PUBLISH_INTERVAL = 5;
@@ -63,6 +65,9 @@ public:
                     const int measurementInterval = DEFAULT_MEASUREMENT_INTERVAL,
                     const int publishInterval = DEFAULT_PUBLISH_INTERVAL);
 
+  virtual void sample() override;
+  virtual void collect() override;
+
   float getDistance() const { return _distance; }
   int getPingTime() const { return _ping_us; }
   PingNode &setTemperature(float temperatureCelcius);
@@ -0,0 +1,105 @@
+/*
+ * PublishWindow.cpp
+ * Aligns the publishes of all sensor nodes into shared windows and lets the
+ * WiFi modem sleep in between.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "PublishWindow.hpp"
+#include "EnergyMonitor.hpp"
+#include "NodeClock.hpp"
+
+PublishWindow *PublishWindow::active = NULL;
+
+PublishWindow::PublishWindow(unsigned long period, unsigned long length, unsigned long lead, bool lightSleep)
+    : _period((period > 0) ? period * 1000UL : 1000UL),
+      _length((length < _period) ? length : _period),
+      _lead(lead),
+      _lightSleep(lightSleep)
+{
+}
+
+uint64_t PublishWindow::now()
+{
+  // The grid is aligned to time 0 of a 64 bit clock, so the windows keep their
+  // period across the millis() wraparound after 49.7 days. The nodes call this
+  // every loop, so no wraparound is missed.
+  unsigned long now = NodeClock::now();
+  if (now < _lastNow)
+  {
+    _epoch += (uint64_t)1 << 32;
+  }
+  _lastNow = now;
+  return _epoch + now;
+}
+
+uint64_t PublishWindow::extend(uint64_t now, unsigned long time)
+{
+  // <time> lies less than 49.7 days before <now>
+  return now - (unsigned long)((unsigned long)now - time);
+}
+
+bool PublishWindow::isOpen()
+{
+  return now() % _period < _length;
+}
+
+bool PublishWindow::isDue(unsigned long last, unsigned long interval)
+{
+  if ((last == 0) || (interval == 0))
+  {
+    return true;
+  }
+  // The grid points lie <lead> ms before multiples of the interval
+  uint64_t current = now();
+  return (current + _lead) / interval != (extend(current, last) + _lead) / interval;
+}
+
+unsigned long PublishWindow::untilDue(unsigned long last, unsigned long interval)
+{
+  if (isDue(last, interval))
+  {
+    return 0;
+  }
+  return interval - (now() + _lead) % interval;
+}
+
+unsigned long PublishWindow::untilChange()
+{
+  unsigned long position = now() % _period;
+  return (position < _length) ? _length - position : _period - position;
+}
+
+void PublishWindow::setSleep(bool sleep)
+{
+  if (EnergyMonitor::active)
+  {
+    EnergyMonitor::active->radio(!sleep);
+  }
+#ifdef ESP8266
+  // The connection to the access point is kept in both sleep modes. Light sleep
+  // also suspends the CPU, but only while the sketch calls delay().
+  WiFi.setSleepMode(sleep ? (_lightSleep ? WIFI_LIGHT_SLEEP : WIFI_MODEM_SLEEP) : WIFI_NONE_SLEEP);
+#elif defined(ESP32)
+  // Modem sleep, the connection to the access point is kept. With light sleep the
+  // modem skips more beacons. The CPU only sleeps with automatic light sleep in the
+  // power management of ESP-IDF.
+  WiFi.setSleep(sleep ? (_lightSleep ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM) : WIFI_PS_NONE);
+#endif
+}
+
+void PublishWindow::update()
+{
+  bool open = isOpen();
+  if (open != _open)
+  {
+    _open = open;
+    if (open)
+    {
+      _windows++;
+    }
+    setSleep(!open);
+  }
+}
@@ -0,0 +1,49 @@
+/*
+ * PublishWindow.hpp
+ * Aligns the publishes of all sensor nodes into shared windows and lets the
+ * WiFi modem sleep in between.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+
+class PublishWindow
+{
+private:
+  unsigned long _period; // Milliseconds between the start of two windows
+  unsigned long _length; // Milliseconds the window stays open
+  unsigned long _lead;   // Milliseconds the measurements start before a window opens
+  bool _lightSleep;
+  bool _open = false;
+  uint32_t _windows = 0;
+  uint64_t _epoch = 0;         // Milliseconds before the last millis() wraparound
+  unsigned long _lastNow = 0;
+
+  uint64_t now();
+  uint64_t extend(uint64_t now, unsigned long time);
+  void setSleep(bool sleep);
+
+public:
+  // The window all nodes align to. NULL = publish immediately
+  static PublishWindow *active;
+
+  // Open a window of <length> ms every <period> seconds. The measurements are
+  // started <lead> ms before, so that slow conversions are finished in time.
+  explicit PublishWindow(unsigned long period = 60, unsigned long length = 1000,
+                         unsigned long lead = 1000, bool lightSleep = false);
+
+  bool isOpen();
+  // True, if a grid point of <interval> ms has passed since <last>
+  bool isDue(unsigned long last, unsigned long interval);
+  // Milliseconds until isDue() becomes true
+  unsigned long untilDue(unsigned long last, unsigned long interval);
+  // Milliseconds until the window opens or closes
+  unsigned long untilChange();
+  // Switches the radio on when a window opens and back to sleep when it closes
+  void update();
+  uint32_t getWindows() const { return _windows; }
+};
@@ -25,9 +25,9 @@ PulseNode::PulseNode(const char *id,
   asprintf(&_checkActivePulsesName, "%s.activePulses", id);
   _checkActivePulses = new HomieSetting<long>(_checkActivePulsesName, "The number of pulses per interval to be considered active [1 .. Max(long)]. Default = 10");
 
-  advertise("active")
+  advertise(cActiveTopic)
       .setDatatype("boolean");
-  advertise("pulses")
+  advertise(cPulsesTopic)
       .setDatatype("float")
       .setUnit(cUnitHz);
 }
@@ -36,14 +36,29 @@ PulseNode::PulseNode(const char *id,
 void PulseNode::checkState(void)
 {
   noInterrupts();
+  PROFILE_INTERRUPTS_OFF();
   unsigned long _copyPulse = _pulse;
   _pulse = 0;
+  PROFILE_INTERRUPTS_ON();
   interrupts();
+  _copyPulse = trace(0, _copyPulse);
+  countSample(true);
+  _totalPulses += _copyPulse;
+  if (RtcStore::active)
+  {
+    RtcStore::active->setCounter(getId(), RTC_TOTAL_PULSES, _totalPulses);
+  }
 
   _isPulsing = (_copyPulse > (unsigned long)_checkActivePulses->get());
 
+  PROFILE_PHASE(PHASE_SEND);
   float _frequency = _copyPulse * 1000 / _checkInterval->get();
-  setProperty("pulses").send(String(_frequency));
+  publish(cPulsesTopic, _frequency);
+  if (_publishTotal)
+  {
+    publish(cTotalTopic, (unsigned long)_totalPulses);
+  }
+  publishBatch();
 
 #ifdef DEBUG_PULSE
   Homie.getLogger() << F("Active: ") << _isPulsing << F(" pulses: ") << _copyPulse << F(" frequency:") << _frequency << endl;
@@ -52,10 +67,8 @@ void PulseNode::checkState(void)
 
 void PulseNode::handleStateChange(bool active)
 {
-  if (Homie.isConnected())
-  {
-    setProperty("active").send(active ? F("true") : F("false"));
-  }
+  publish(cActiveTopic, active ? F("true") : F("false"));
+  publishBatch();
 
   if (_stateChangeCallback)
   {
@@ -71,6 +84,17 @@ void PulseNode::onChange(TStateChangeCallback stateChangeCallback)
   _stateChangeCallback = stateChangeCallback;
 }
 
+PulseNode &PulseNode::enableTotal()
+{
+  if (!_publishTotal)
+  {
+    _publishTotal = true;
+    advertise(cTotalTopic)
+        .setDatatype("integer");
+  }
+  return *this;
+}
+
 void IRAM_ATTR PulseNode::onInterrupt()
 {
   _pulse++;
@@ -88,21 +112,51 @@ void PulseNode::beforeHomieSetup()
 
 void PulseNode::loop()
 {
+  LoopTimer loopTimer(*this);
+  PROFILE_PHASE(PHASE_LOOP);
+  SensorNode::loop();
+
   if (_pulsePin > DEFAULTPIN)
   {
-    if ((millis() - _lastCheck >= (unsigned long)_checkInterval->get()) || (_lastCheck == 0))
+    if ((NodeClock::now() - _lastCheck >= (unsigned long)_checkInterval->get()) || (_lastCheck == 0))
     {
       checkState();
       if (_lastSentState != _isPulsing)
       {
         handleStateChange(_isPulsing);
         _lastSentState = _isPulsing;
+        if (RtcStore::active)
+        {
+          RtcStore::active->setCounter(getId(), RTC_LAST_STATE, _lastSentState);
+        }
       }
-      _lastCheck = millis();
+      _lastCheck = NodeClock::now();
     }
   }
 }
 
+unsigned long PulseNode::nextDeadline()
+{
+  // The pulses are counted in the interrupt, the loop only evaluates them
+  unsigned long deadline = SensorNode::nextDeadline();
+  if (_pulsePin > DEFAULTPIN)
+  {
+    deadline = earlier(deadline, untilElapsed(_lastCheck, (unsigned long)_checkInterval->get()));
+  }
+  return deadline;
+}
+
+void PulseNode::restoreState(RtcStore &store)
+{
+  SensorNode::restoreState(store);
+  uint32_t lastSentState;
+  if (store.getCounter(getId(), RTC_LAST_STATE, lastSentState))
+  {
+    _lastSentState = lastSentState;
+  }
+  store.getCounter(getId(), RTC_TOTAL_PULSES, _totalPulses);
+}
+
 void PulseNode::setup()
 {
   printCaption();
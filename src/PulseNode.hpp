@@ -26,6 +26,13 @@ public:
 private:
   const char *cCaption = "• %s pulse pin[%d]:";
 
+  // Keys of the counters in the RtcStore
+  enum
+  {
+    RTC_LAST_STATE,
+    RTC_TOTAL_PULSES
+  };
+
   TStateChangeCallback _stateChangeCallback;
   uint8_t _pulsePin;
 
@@ -35,6 +42,8 @@ private:
   bool _isPulsing = false;
   bool _lastSentState = true; // force sending of "false" in first loop
   unsigned long _lastCheck = 0;
+  uint32_t _totalPulses = 0; // Kept across deep sleep with an RtcStore
+  bool _publishTotal = false;
 
   // This value is changed inside the interrupt routine
   volatile unsigned long _pulse = 0;
@@ -47,6 +56,8 @@ protected:
   HomieSetting<long> *_checkActivePulses;
 
   virtual void loop() override;
+  virtual unsigned long nextDeadline() override;
+  virtual void restoreState(RtcStore &store) override;
   virtual void setup() override;
 
 public:
@@ -56,6 +67,8 @@ public:
                      // void (*)(void) interruptCallback,
                      TStateChangeCallback stateChangeCallback = NULL);
   void onChange(TStateChangeCallback stateChangeCallback);
+  // Publishes the number of pulses as "total". Call before Homie.setup().
+  PulseNode &enableTotal();
   void IRAM_ATTR onInterrupt();
   void beforeHomieSetup();
 };
@@ -8,19 +8,20 @@
 
 #pragma once
 
-#include <Homie.hpp>
+#include "RelayNodeBase.hpp"
+#include "constants.hpp"
 
 #define DEFAULTPIN -1
 
-class RelayNode : public HomieNode
+class RelayNode : public RelayNodeImpl<RelayNode>
 {
+  friend class RelayNodeImpl<RelayNode>;
+
 public:
   typedef std::function<bool(int8_t)> TGetRelayState;
   typedef std::function<void(int8_t, bool)> TSetRelayState;
 
 private:
-  const char *cIndent = "  ◦ ";
-
   int8_t _callbackId;
   int8_t _relayPin;
   int8_t _ledPin;
@@ -31,30 +32,12 @@ private:
   uint8_t _relayOnValue;
   uint8_t _relayOffValue;
 
-  char *_caption;
-  char *_maxTimeoutName;
-
-  long _timeout;
-  Ticker _ticker;
-
-  bool handleOnOff(const String &value);
-  bool handleTimeout(const String &value);
-
-  void commonInit(const char *id, bool reverseSignal);
-  void printCaption();
-  void sendState();
-  void tick();
-
+  void commonInit(bool reverseSignal);
   void setLed(bool on);
-  void setTimeout(bool on, long timeoutSecs);
-
-  bool getRelay();
 
 protected:
-  HomieSetting<long> *_maxTimeout;
-
-  virtual bool handleInput(const HomieRange &range, const String &property, const String &value) override;
-  virtual void onReadyToOperate() override;
+  // Returns false if neither a relay pin nor a callback is defined
+  bool writeRelay(bool on);
   virtual void setup() override;
 
 public:
@@ -71,7 +54,6 @@ public:
                      TGetRelayState OnGetRelayState,
                      TSetRelayState OnSetRelayState,
                      const bool reverseSignal = false);
-  void setRelay(bool on, long timeoutSecs);
-  void toggleRelay();
-  void beforeHomieSetup();
+
+  bool getRelay();
 };
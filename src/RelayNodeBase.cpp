@@ -0,0 +1,131 @@
+/*
+ * RelayNodeBase.cpp
+ * Commands, timeout and state publishing shared by RelayNode and RelayNodeT.
+ * RelayNodeImpl in the header switches the relay of the derived class.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "RelayNodeBase.hpp"
+
+RelayNodeBase::RelayNodeBase(const char *id, const char *name)
+    : SensorNode(id, name, "Relay")
+{
+  // Report state changes immediately, not in the next publish window
+  _alignPublishes = false;
+
+  asprintf(&_maxTimeoutName, "%s.maxTimeout", id);
+  _maxTimeout = new HomieSetting<long>(_maxTimeoutName, "The maximum timeout for the relay in seconds [0 .. Max(long)] Default = 600 (10 minutes)");
+
+  advertise(cOnTopic)
+      .setDatatype("boolean")
+      .settable();
+  _commands.addProperty(cOnTopic);
+
+  advertise(cTimeoutTopic)
+      .setDatatype("integer")
+      .settable();
+  _commands.addProperty(cTimeoutTopic);
+}
+
+CommandParser::Switch RelayNodeBase::parseInput(const String &property, const String &value, long &timeoutSecs)
+{
+  timeoutSecs = _maxTimeout->get();
+
+  switch (_commands.findProperty(property))
+  {
+  case CMD_ON:
+    return CommandParser::parseSwitch(value.c_str(), timeoutSecs);
+  case CMD_TIMEOUT:
+    // A timeout switches the relay on for the given number of seconds
+    if (CommandParser::parseLong(value.c_str(), timeoutSecs) && (timeoutSecs > 0))
+    {
+      return CommandParser::SWITCH_ON;
+    }
+    return CommandParser::SWITCH_INVALID;
+  default:
+    return CommandParser::SWITCH_INVALID;
+  }
+}
+
+void RelayNodeBase::beforeHomieSetup()
+{
+  _maxTimeout->setDefaultValue(600).setValidator([](long candidate) {
+    return (candidate >= 0);
+  });
+}
+
+unsigned long RelayNodeBase::nextDeadline()
+{
+  unsigned long deadline = SensorNode::nextDeadline();
+  if (_ticking)
+  {
+    deadline = earlier(deadline, untilElapsed(_lastTick, 1000UL));
+  }
+  return deadline;
+}
+
+void RelayNodeBase::sendState(bool on)
+{
+  PROFILE_PHASE(PHASE_SEND);
+  unsigned long logStart = micros();
+  printCaption();
+  Homie.getLogger() << cIndent << F("is ") << (on ? F("on") : F("off")) << endl;
+  if (_latency)
+  {
+    _latency->record(LatencyTrace::STAGE_LOG, micros() - logStart);
+  }
+  publish(cOnTopic, on ? F("true") : F("false"));
+  publish(cTimeoutTopic, _timeout);
+  publishBatch();
+}
+
+void RelayNodeBase::relaySwitched(bool on, long timeoutSecs)
+{
+  traceActuated();
+  setTimeout(on, timeoutSecs);
+  sendState(on);
+}
+
+void RelayNodeBase::setTimeout(bool on, long timeoutSecs)
+{
+  long maxTimeout = _maxTimeout->get();
+
+  if ((maxTimeout > 0) && maxTimeout < timeoutSecs)
+  {
+    timeoutSecs = maxTimeout;
+  }
+
+  if (on && timeoutSecs > 0)
+  {
+    _ticking = true;
+    _lastTick = NodeClock::now();
+    _timeout = timeoutSecs;
+  }
+  else
+  {
+    _ticking = false;
+    _timeout = 0;
+  }
+}
+
+bool RelayNodeBase::tick()
+{
+  if (!_ticking || (NodeClock::now() - _lastTick < 1000UL))
+  {
+    return false;
+  }
+  _lastTick += 1000UL;
+
+  if (_timeout > 0)
+  {
+    _timeout--;
+    publish(cTimeoutTopic, _timeout);
+    publishBatch();
+    return false;
+  }
+  // Also stops the timeout if there is no relay to switch off
+  _ticking = false;
+  return true;
+}
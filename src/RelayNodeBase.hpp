@@ -0,0 +1,128 @@
+/*
+ * RelayNodeBase.hpp
+ * Commands, timeout and state publishing shared by RelayNode and RelayNodeT.
+ * RelayNodeImpl switches the relay of the derived class without virtual calls,
+ * the derived classes only read and switch the relay and the LED.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include "CommandParser.hpp"
+#include "SensorNode.hpp"
+#include "constants.hpp"
+
+class RelayNodeBase : public SensorNode
+{
+private:
+  // Ids of the settable properties, in the order they are added to _commands
+  enum
+  {
+    CMD_ON,
+    CMD_TIMEOUT
+  };
+
+  CommandParser _commands;
+  char *_maxTimeoutName;
+
+  long _timeout = 0;
+  bool _ticking = false;
+  unsigned long _lastTick = 0;
+
+  void sendState(bool on);
+  void setTimeout(bool on, long timeoutSecs);
+
+protected:
+  HomieSetting<long> *_maxTimeout;
+
+  // Turns an "on" or "timeout" command into a switch command and its timeout
+  CommandParser::Switch parseInput(const String &property, const String &value, long &timeoutSecs);
+  // Counts the timeout down once per second. Returns true when it has expired.
+  bool tick();
+  // Starts or stops the timeout and publishes the state after the relay was switched
+  void relaySwitched(bool on, long timeoutSecs);
+
+  virtual unsigned long nextDeadline() override;
+
+  explicit RelayNodeBase(const char *id, const char *name);
+
+public:
+  void beforeHomieSetup();
+};
+
+// The parts that switch the relay. Derived implements getRelay() and writeRelay(bool on),
+// which returns false if there is no relay to switch. They are called directly, so a
+// RelayNodeT needs neither a virtual call nor a check for callbacks to switch its pin.
+template <typename Derived>
+class RelayNodeImpl : public RelayNodeBase
+{
+private:
+  Derived &relay()
+  {
+    return *static_cast<Derived *>(this);
+  }
+
+protected:
+  virtual bool handleInput(const HomieRange &range, const String &property, const String &value) override
+  {
+    PROFILE_PHASE(PHASE_INPUT);
+    CommandTrace commandTrace(*this);
+#ifdef DEBUG
+    Homie.getLogger() << "Message: " << property << " " << value << endl;
+#endif
+    long timeout;
+    switch (parseInput(property, value, timeout))
+    {
+    case CommandParser::SWITCH_ON:
+      setRelay(true, timeout);
+      return true;
+    case CommandParser::SWITCH_OFF:
+      setRelay(false, timeout);
+      return true;
+    case CommandParser::SWITCH_TOGGLE:
+      setRelay(!relay().getRelay(), timeout);
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  virtual void loop() override
+  {
+    LoopTimer loopTimer(*this);
+    PROFILE_PHASE(PHASE_LOOP);
+    SensorNode::loop();
+
+    if (tick())
+    {
+      setRelay(false, 0);
+    }
+  }
+
+  virtual void onReadyToOperate() override
+  {
+    setRelay(false, 0);
+    SensorNode::onReadyToOperate();
+  }
+
+  explicit RelayNodeImpl(const char *id, const char *name)
+      : RelayNodeBase(id, name)
+  {
+  }
+
+public:
+  void setRelay(bool on, long timeoutSecs)
+  {
+    if (relay().writeRelay(on))
+    {
+      relaySwitched(on, timeoutSecs);
+    }
+  }
+
+  void toggleRelay()
+  {
+    setRelay(!relay().getRelay(), _maxTimeout->get());
+  }
+};
@@ -0,0 +1,63 @@
+/*
+ * RelayNodeT.hpp
+ * Homie Node for a Relay with optional status indicator LED.
+ * Pins and polarity are template parameters, so reading and switching the pins
+ * needs neither a virtual call nor checks at runtime. The command parsing, the
+ * timeout and the publishing are shared with RelayNode in RelayNodeBase.
+ * Use RelayNode if the relay is controlled via callbacks.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include "RelayNodeBase.hpp"
+#include "constants.hpp"
+
+#define DEFAULTPIN -1
+
+template <int8_t RelayPin, int8_t LedPin = DEFAULTPIN, bool Inverted = false>
+class RelayNodeT : public RelayNodeImpl<RelayNodeT<RelayPin, LedPin, Inverted>>
+{
+  static_assert(RelayPin > DEFAULTPIN, "RelayNodeT needs a relay pin");
+  friend class RelayNodeImpl<RelayNodeT>;
+
+private:
+  static const uint8_t cRelayOnValue = Inverted ? LOW : HIGH;
+  static const uint8_t cRelayOffValue = Inverted ? HIGH : LOW;
+
+protected:
+  bool writeRelay(bool on)
+  {
+    digitalWrite(RelayPin, on ? cRelayOnValue : cRelayOffValue);
+    if (LedPin > DEFAULTPIN)
+    {
+      digitalWrite(LedPin, on ? LOW : HIGH); // LOW = LED on
+    }
+    return true;
+  }
+
+  virtual void setup() override
+  {
+    this->printCaption();
+
+    if (LedPin > DEFAULTPIN)
+    {
+      pinMode(LedPin, OUTPUT);
+    }
+    pinMode(RelayPin, OUTPUT);
+  }
+
+public:
+  explicit RelayNodeT(const char *id, const char *name)
+      : RelayNodeImpl<RelayNodeT>(id, name)
+  {
+    asprintf(&this->_caption, "• %s relay pin[%d]:", name, RelayPin);
+  }
+
+  bool getRelay()
+  {
+    return digitalRead(RelayPin) == cRelayOnValue;
+  }
+};
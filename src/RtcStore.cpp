@@ -0,0 +1,148 @@
+/*
+ * RtcStore.cpp
+ * Keeps the last published values and small counters of the nodes in RTC
+ * memory, protected by a CRC, so that they survive deep sleep.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "RtcStore.hpp"
+#include "NodeClock.hpp"
+#include "NodeTrace.hpp"
+
+#if defined(ESP32)
+// Keeps its content in deep sleep, but not after a power on
+RTC_DATA_ATTR static uint8_t rtcMemory[512];
+#endif
+
+RtcStore *RtcStore::active = NULL;
+
+RtcStore::RtcStore()
+{
+  clear();
+}
+
+uint32_t RtcStore::crc32(const uint8_t *data, size_t length)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  while (length--)
+  {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+void RtcStore::clear()
+{
+  memset(&_image, 0, sizeof(_image));
+  _image.header.magic = MAGIC;
+}
+
+bool RtcStore::load()
+{
+#ifdef ESP8266
+  bool read = ESP.rtcUserMemoryRead(RTC_OFFSET / 4, (uint32_t *)&_image, sizeof(_image));
+#else
+  memcpy(&_image, rtcMemory + RTC_OFFSET, sizeof(_image));
+  bool read = true;
+#endif
+  if (!read || (_image.header.magic != MAGIC) ||
+      (_image.header.crc != crc32((const uint8_t *)&_image + sizeof(uint32_t), sizeof(_image) - sizeof(uint32_t))))
+  {
+    clear();
+    return false;
+  }
+
+  // Move the times into the time base of this boot, so that their age stays correct
+  for (uint8_t i = 0; i < MAX_ENTRIES; i++)
+  {
+    _image.entries[i].time -= _image.header.clock;
+  }
+  return true;
+}
+
+void RtcStore::save(unsigned long sleepTime)
+{
+  _image.header.magic = MAGIC;
+  _image.header.clock = NodeClock::now() + sleepTime;
+  _image.header.crc = crc32((const uint8_t *)&_image + sizeof(uint32_t), sizeof(_image) - sizeof(uint32_t));
+#ifdef ESP8266
+  ESP.rtcUserMemoryWrite(RTC_OFFSET / 4, (uint32_t *)&_image, sizeof(_image));
+#else
+  memcpy(rtcMemory + RTC_OFFSET, &_image, sizeof(_image));
+#endif
+}
+
+RtcStore::Entry *RtcStore::find(const char *node, uint8_t key, EntryType type, bool create)
+{
+  uint16_t hash = NodeTrace::hashId(node);
+  Entry *free = NULL;
+  for (uint8_t i = 0; i < MAX_ENTRIES; i++)
+  {
+    Entry &entry = _image.entries[i];
+    if ((entry.type == type) && (entry.node == hash) && (entry.key == key))
+    {
+      return &entry;
+    }
+    if (!free && (entry.type == ENTRY_FREE))
+    {
+      free = &entry;
+    }
+  }
+  if (create && free)
+  {
+    free->node = hash;
+    free->key = key;
+    free->type = type;
+    return free;
+  }
+  return NULL;
+}
+
+bool RtcStore::getValue(const char *node, uint8_t index, char *value, unsigned long &time)
+{
+  Entry *entry = find(node, index, ENTRY_VALUE, false);
+  if (entry)
+  {
+    memcpy(value, entry->value, MAX_VALUE_LENGTH);
+    value[MAX_VALUE_LENGTH - 1] = '\0';
+    time = entry->time;
+  }
+  return entry != NULL;
+}
+
+void RtcStore::setValue(const char *node, uint8_t index, const char *value, unsigned long time)
+{
+  Entry *entry = find(node, index, ENTRY_VALUE, true);
+  if (entry)
+  {
+    strncpy(entry->value, value, MAX_VALUE_LENGTH - 1);
+    entry->value[MAX_VALUE_LENGTH - 1] = '\0';
+    entry->time = time;
+  }
+}
+
+bool RtcStore::getCounter(const char *node, uint8_t key, uint32_t &value)
+{
+  Entry *entry = find(node, key, ENTRY_COUNTER, false);
+  if (entry)
+  {
+    memcpy(&value, entry->value, sizeof(value));
+  }
+  return entry != NULL;
+}
+
+void RtcStore::setCounter(const char *node, uint8_t key, uint32_t value)
+{
+  Entry *entry = find(node, key, ENTRY_COUNTER, true);
+  if (entry)
+  {
+    memcpy(entry->value, &value, sizeof(value));
+    entry->time = NodeClock::now();
+  }
+}
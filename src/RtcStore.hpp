@@ -0,0 +1,78 @@
+/*
+ * RtcStore.hpp
+ * Keeps the last published values and small counters of the nodes in RTC
+ * memory, protected by a CRC, so that they survive deep sleep.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class RtcStore
+{
+public:
+  static const int MAX_VALUE_LENGTH = 12;
+
+private:
+  // The first 128 bytes of the ESP8266 RTC user memory are used by OTA updates
+  static const uint32_t RTC_OFFSET = 128;
+  static const uint32_t RTC_SIZE = 512 - RTC_OFFSET;
+  static const uint32_t MAGIC = 0x52544331; // "RTC1"
+
+  enum EntryType
+  {
+    ENTRY_FREE,
+    ENTRY_VALUE,
+    ENTRY_COUNTER
+  };
+
+  struct Entry
+  {
+    uint16_t node; // NodeTrace::hashId() of the node id
+    uint8_t key;   // Index of the property or number of the counter
+    uint8_t type;
+    uint32_t time; // NodeClock time when the value was sent
+    char value[MAX_VALUE_LENGTH];
+  };
+
+  struct Header
+  {
+    uint32_t crc;   // Over everything after the crc
+    uint32_t magic;
+    uint32_t clock; // NodeClock time at the end of the deep sleep
+  };
+
+  static const int MAX_ENTRIES = (RTC_SIZE - sizeof(Header)) / sizeof(Entry);
+
+  struct Image
+  {
+    Header header;
+    Entry entries[MAX_ENTRIES];
+  };
+
+  Image _image;
+
+  static uint32_t crc32(const uint8_t *data, size_t length);
+  Entry *find(const char *node, uint8_t key, EntryType type, bool create);
+
+public:
+  // The store all nodes use. NULL = nothing is kept
+  static RtcStore *active;
+
+  RtcStore();
+
+  // Call at the start of setup(). Returns false after a power on or reset, or if
+  // the CRC doesn't match.
+  bool load();
+  // Call right before going into deep sleep for <sleepTime> milliseconds
+  void save(unsigned long sleepTime);
+  void clear();
+
+  bool getValue(const char *node, uint8_t index, char *value, unsigned long &time);
+  void setValue(const char *node, uint8_t index, const char *value, unsigned long time);
+  bool getCounter(const char *node, uint8_t key, uint32_t &value);
+  void setCounter(const char *node, uint8_t key, uint32_t value);
+};
@@ -0,0 +1,153 @@
+/*
+ * SampleBuffer.cpp
+ * Ring buffer for timestamped measurement values that could not be
+ * published, with optional spill to LittleFS.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "SampleBuffer.hpp"
+
+SampleBuffer::SampleBuffer(uint16_t capacity, const char *spillFile)
+    : _capacity(capacity),
+      _spillFile(spillFile)
+{
+  _samples = new Sample[_capacity];
+}
+
+SampleBuffer::~SampleBuffer()
+{
+#ifdef BACKLOG_LITTLEFS
+  closeFile();
+#endif
+  delete[] _samples;
+}
+
+#ifdef BACKLOG_LITTLEFS
+bool SampleBuffer::openFile(FileMode mode)
+{
+  if (_fileMode == mode)
+  {
+    return true;
+  }
+  if (_fileMode == FILE_UNUSED)
+  {
+    // Samples from before a reboot carry meaningless timestamps. LittleFS is
+    // mounted by now, it isn't yet when the buffer is constructed.
+    LittleFS.remove(_spillFile);
+  }
+  closeFile();
+
+  _file = LittleFS.open(_spillFile, (mode == FILE_WRITING) ? "a" : "r");
+  if (!_file)
+  {
+    return false;
+  }
+  _fileMode = mode;
+  return (mode == FILE_WRITING) || _file.seek(_spillReadPos);
+}
+
+void SampleBuffer::closeFile()
+{
+  if ((_fileMode == FILE_WRITING) || (_fileMode == FILE_READING))
+  {
+    _file.close();
+  }
+  if (_fileMode != FILE_UNUSED)
+  {
+    _fileMode = FILE_CLOSED;
+  }
+}
+#endif
+
+void SampleBuffer::push(uint8_t index, float value, uint32_t time)
+{
+  if (_capacity == 0)
+  {
+    _dropped++;
+    return;
+  }
+
+  if (_count == _capacity)
+  {
+    // Full: move the oldest sample to flash, or drop it
+    if (!spill(_samples[_head]))
+    {
+      _dropped++;
+    }
+    _head = (_head + 1) % _capacity;
+    _count--;
+  }
+
+  Sample &sample = _samples[(_head + _count) % _capacity];
+  sample.time = time;
+  sample.value = value;
+  sample.index = index;
+  _count++;
+}
+
+bool SampleBuffer::pop(Sample &sample)
+{
+  // Spilled samples are older than the ones in RAM
+  if (unspill(sample))
+  {
+    return true;
+  }
+
+  if (_count == 0)
+  {
+    return false;
+  }
+
+  sample = _samples[_head];
+  _head = (_head + 1) % _capacity;
+  _count--;
+  return true;
+}
+
+bool SampleBuffer::spill(const Sample &sample)
+{
+#ifdef BACKLOG_LITTLEFS
+  if (_spillFile && (_spillSize + sizeof(Sample) <= MAX_SPILL_SIZE) && openFile(FILE_WRITING))
+  {
+    if (_file.write((const uint8_t *)&sample, sizeof(Sample)) == sizeof(Sample))
+    {
+      _spillSize += sizeof(Sample);
+      return true;
+    }
+  }
+#else
+  (void)sample;
+#endif
+  return false;
+}
+
+bool SampleBuffer::unspill(Sample &sample)
+{
+#ifdef BACKLOG_LITTLEFS
+  if (_spillReadPos < _spillSize)
+  {
+    bool read = openFile(FILE_READING) &&
+                (_file.read((uint8_t *)&sample, sizeof(Sample)) == sizeof(Sample));
+    _spillReadPos += sizeof(Sample);
+
+    if (_spillReadPos >= _spillSize)
+    {
+      // Everything has been replayed, start over with an empty file
+      closeFile();
+      LittleFS.remove(_spillFile);
+      _spillReadPos = 0;
+      _spillSize = 0;
+    }
+    if (read)
+    {
+      return true;
+    }
+    _dropped++;
+  }
+#else
+  (void)sample;
+#endif
+  return false;
+}
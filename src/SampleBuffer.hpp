@@ -0,0 +1,75 @@
+/*
+ * SampleBuffer.hpp
+ * Ring buffer for timestamped measurement values that could not be
+ * published, with optional spill to LittleFS.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// Uncomment to move samples that don't fit into RAM to LittleFS.
+// LittleFS must be mounted by the firmware or by Homie.
+// #define BACKLOG_LITTLEFS
+
+#ifdef BACKLOG_LITTLEFS
+#include <LittleFS.h>
+#endif
+
+class SampleBuffer
+{
+public:
+  struct __attribute__((packed)) Sample
+  {
+    uint32_t time; // millis() when the value was measured
+    float value;
+    uint8_t index; // Index of the property in the node
+  };
+
+private:
+  static const uint32_t MAX_SPILL_SIZE = 32 * 1024; // in bytes
+
+  Sample *_samples;
+  uint16_t _capacity;
+  uint16_t _head = 0; // Next sample to pop
+  uint16_t _count = 0;
+  uint32_t _dropped = 0;
+
+  const char *_spillFile;
+  uint32_t _spillReadPos = 0;
+  uint32_t _spillSize = 0;
+
+#ifdef BACKLOG_LITTLEFS
+  enum FileMode
+  {
+    FILE_UNUSED,  // The file from before the reboot hasn't been removed yet
+    FILE_CLOSED,
+    FILE_WRITING,
+    FILE_READING
+  };
+
+  // Stays open while spilling or draining, so that each sample doesn't open the file
+  File _file;
+  FileMode _fileMode = FILE_UNUSED;
+
+  bool openFile(FileMode mode);
+  void closeFile();
+#endif
+
+  bool spill(const Sample &sample);
+  bool unspill(Sample &sample);
+
+public:
+  explicit SampleBuffer(uint16_t capacity, const char *spillFile = NULL);
+  ~SampleBuffer();
+
+  void push(uint8_t index, float value, uint32_t time);
+  bool pop(Sample &sample);
+
+  bool isEmpty() const { return (_count == 0) && (_spillReadPos >= _spillSize); }
+  uint16_t count() const { return _count; }
+  uint32_t dropped() const { return _dropped; }
+};
@@ -9,10 +9,29 @@
 
 #include "SensorNode.hpp"
 
+const SensorNode::PublishPolicy SensorNode::DEFAULT_POLICY = {NAN, 0, 0, 0, 1, true};
+
+SensorNode *SensorNode::_first = NULL;
+unsigned long SensorNode::_drainInterval = DRAIN_INTERVAL;
+unsigned long SensorNode::_lastDrain = 0;
+unsigned long SensorNode::_drainStart = 0;
+unsigned long SensorNode::_startupTime = 0;
+bool SensorNode::_trackHeap = false;
+
 SensorNode::SensorNode(const char *id, const char *name, const char *type)
     : HomieNode(id, name, type),
-    _caption(0)
+    _caption(0),
+    _next(_first)
 {
+  _first = this;
+
+  // Keep measuring while WiFi/MQTT are not connected, the values are cached until then
+  setRunLoopDisconnected(true);
+
+#if defined(NODE_PROFILER) || defined(DEBUG_HEAP)
+  // The histograms and the heap losses are printed with the statistics
+  setStatsInterval(STATS_INTERVAL);
+#endif
 }
 
 float SensorNode::computeAbsoluteHumidity(float temperature, float percentHumidity) {
@@ -48,6 +67,1147 @@ void SensorNode::fixRange(float *value, float min, float max)
   };
 }
 
+bool SensorNode::isDue(unsigned long last, unsigned long interval)
+{
+  if (_alignPublishes && PublishWindow::active)
+  {
+    // Snap to the grid of the publish windows, so that all nodes measure at the same time
+    return PublishWindow::active->isDue(last, interval);
+  }
+  return (NodeClock::now() - last >= interval) || (last == 0);
+}
+
+bool SensorNode::isMeasurementDue()
+{
+  return isDue(_lastMeasurement, _measurementInterval * 1000UL);
+}
+
+unsigned long SensorNode::untilElapsed(unsigned long last, unsigned long interval)
+{
+  unsigned long elapsed = NodeClock::now() - last;
+  return (last == 0) || (elapsed >= interval) ? 0 : interval - elapsed;
+}
+
+unsigned long SensorNode::untilDue(unsigned long last, unsigned long interval)
+{
+  if (_alignPublishes && PublishWindow::active)
+  {
+    return PublishWindow::active->untilDue(last, interval);
+  }
+  return untilElapsed(last, interval);
+}
+
+unsigned long SensorNode::untilMeasurement()
+{
+#ifdef ACQUISITION_TASK
+  if (_requestPending)
+  {
+    // The task wakes the loop when the conversion is finished
+    return TicklessIdle::FOREVER;
+  }
+#endif
+  return untilDue(_lastMeasurement, _measurementInterval * 1000UL);
+}
+
+unsigned long SensorNode::nextDeadline()
+{
+  if (!_started || (_draining && Homie.isConnected()))
+  {
+    return 0;
+  }
+
+#ifdef ACQUISITION_TASK
+  // The task polls the conversion and wakes the loop when it is finished.
+  // It also writes _measuring, so the loop only reads it without a task.
+  if (_acquisitionTask && !_acquired->isEmpty())
+  {
+    return 0;
+  }
+  bool polling = !_acquisitionTask && _measuring;
+#else
+  bool polling = _measuring;
+#endif
+  unsigned long deadline = polling ? POLL_INTERVAL : untilAcquire();
+  if (PublishWindow::active)
+  {
+    deadline = earlier(deadline, PublishWindow::active->untilChange());
+  }
+  // While MQTT is not connected, Homie.loop() reconnects and nothing can be sent
+  if (!canSend())
+  {
+    return deadline;
+  }
+
+  if (_batchPending)
+  {
+    return 0;
+  }
+  if (_backlog && !_backlog->isEmpty())
+  {
+    deadline = earlier(deadline, untilElapsed(_lastReplay, BACKLOG_REPLAY_INTERVAL));
+  }
+  if (_history)
+  {
+    deadline = earlier(deadline, _history->untilNextChunk());
+  }
+  if (_statsInterval > 0)
+  {
+    deadline = earlier(deadline, untilElapsed(_lastStats, _statsInterval * 1000UL));
+  }
+  // In batch only mode the values are sent with the batch, like in applyPolicies().
+  // A value that arrived while the window was closed stays pending and would be due forever.
+  if (_batchMode == BATCH_ONLY)
+  {
+    return deadline;
+  }
+  for (uint8_t i = 0; i < _valueCount; i++)
+  {
+    const PropertyValue &slot = _values[i];
+    if (slot.value[0] == '\0')
+    {
+      continue;
+    }
+    if (slot.pending)
+    {
+      deadline = earlier(deadline, untilElapsed(slot.sentTime, slot.policy.minInterval * 1000UL));
+    }
+    if ((slot.policy.maxInterval > 0) && (slot.sent[0] != '\0'))
+    {
+      deadline = earlier(deadline, untilElapsed(slot.sentTime, slot.policy.maxInterval * 1000UL));
+    }
+  }
+  return deadline;
+}
+
+unsigned long SensorNode::nextWakeup()
+{
+  unsigned long wakeup = TicklessIdle::FOREVER;
+  for (SensorNode *node = _first; node && (wakeup > 0); node = node->_next)
+  {
+    wakeup = earlier(wakeup, node->nextDeadline());
+  }
+  return wakeup;
+}
+
+uint32_t SensorNode::simulate(VirtualClock &clock, unsigned long duration)
+{
+  NodeClock::active = &clock;
+  unsigned long start = clock.millis();
+  uint32_t rounds = 0;
+  while (clock.millis() - start < duration)
+  {
+    for (SensorNode *node = _first; node; node = node->_next)
+    {
+      node->loop();
+    }
+    rounds++;
+
+    // A deadline that is due again right away, e.g. a polled conversion or the drain
+    // interval, still moves the clock, or the simulation would never end
+    unsigned long step = nextWakeup();
+    unsigned long remaining = duration - (clock.millis() - start);
+    clock.advance((step == 0) ? 1 : (step < remaining) ? step : remaining);
+  }
+  return rounds;
+}
+
+bool SensorNode::isMeasuring() const
+{
+#ifdef ACQUISITION_TASK
+  // _measuring belongs to the task, a pending request covers the conversion and its collection
+  if (_acquisitionTask)
+  {
+    return _requestPending;
+  }
+#endif
+  return _measuring;
+}
+
+bool SensorNode::canSend()
+{
+  return Homie.isConnected() && !_draining &&
+         (!_alignPublishes || !PublishWindow::active || PublishWindow::active->isOpen());
+}
+
+void SensorNode::runMeasurement(bool due)
+{
+#ifdef ACQUISITION_TASK
+  if (_acquisitionTask)
+  {
+    // The task runs the conversion, collectAcquired() finishes it
+    if (due && !_requestPending)
+    {
+      _measurementStart = NodeClock::now();
+      _requestPending = true;
+      _requests.fetch_add(1, std::memory_order_release);
+    }
+    return;
+  }
+#endif
+
+  if (_measuring)
+  {
+    if (ready())
+    {
+      sample();
+      _measuring = false;
+      finishMeasurement();
+    }
+  }
+  else if (due)
+  {
+    _measurementStart = NodeClock::now();
+    start();
+  }
+}
+
+void SensorNode::finishMeasurement()
+{
+  collect();
+  // Conversions that were started by a coordinator are not counted
+  if (EnergyMonitor::active && (_measurementStart != 0))
+  {
+    EnergyMonitor::active->sensorActive(getId(), NodeClock::now() - _measurementStart);
+  }
+  _measurementStart = 0;
+}
+
+SensorNode &SensorNode::setAdaptiveInterval(unsigned long minInterval, unsigned long maxInterval, float threshold)
+{
+  if (_maxInterval == 0)
+  {
+    advertise(cIntervalTopic).setDatatype("integer").setUnit("s");
+  }
+  _minInterval = (minInterval > 0) ? minInterval : 1;
+  _maxInterval = (maxInterval > _minInterval) ? maxInterval : _minInterval;
+  _rateThreshold = threshold;
+  _measurementInterval = _minInterval;
+  // Cached until MQTT is connected
+  publish(cIntervalTopic, (long)_measurementInterval);
+  return *this;
+}
+
+void SensorNode::adaptInterval(float value)
+{
+  if ((_maxInterval == 0) || isnan(value))
+  {
+    return;
+  }
+
+  unsigned long now = NodeClock::now();
+  if (!isnan(_lastValue))
+  {
+    unsigned long dt = now - _lastValueTime;
+    float rate = fabs(value - _lastValue) * 60000.0 / ((dt > 0) ? dt : 1);
+    unsigned long interval = _minInterval;
+    if (rate <= _rateThreshold)
+    {
+      // Back off geometrically while the signal is stable
+      interval = (_measurementInterval * 2 < _maxInterval) ? _measurementInterval * 2 : _maxInterval;
+    }
+    if (interval != _measurementInterval)
+    {
+      _measurementInterval = interval;
+      publish(cIntervalTopic, (long)_measurementInterval);
+    }
+  }
+  _lastValue = value;
+  _lastValueTime = now;
+}
+
+float SensorNode::trace(uint8_t channel, float value)
+{
+  // The values of a measurement are traced from its first reading
+  if (_latency && (_captureTime == 0))
+  {
+    _captureTime = micros();
+  }
+  // Pass each raw reading through the trace, so it can be recorded or replaced
+  return NodeTrace::active ? NodeTrace::active->sample(getId(), channel, value) : value;
+}
+
+void SensorNode::countSample(bool valid)
+{
+  _stats.samples++;
+  _sequence++;
+  if (valid)
+  {
+    _stats.lastReadTime = NodeClock::now();
+  }
+  else
+  {
+    _stats.readErrors++;
+  }
+}
+
+void SensorNode::sendProperty(const char *property, const char *value, uint8_t qos, bool retained)
+{
+  uint32_t heap = _trackHeap ? ESP.getFreeHeap() : 0;
+  unsigned long start = micros();
+  uint16_t packetId = setProperty(property).setQos(qos).setRetained(retained).send(value);
+  if (_trackHeap)
+  {
+    _stats.heapSend += (int32_t)(heap - ESP.getFreeHeap());
+  }
+  if (_latency)
+  {
+    unsigned long now = micros();
+    _latency->record(LatencyTrace::STAGE_SEND, now - start);
+    if ((qos > 0) && (packetId != 0))
+    {
+      _latency->sent(packetId, now);
+    }
+  }
+  if (NodeTrace::active)
+  {
+    NodeTrace::active->published(getId(), property, value);
+  }
+  if (TrafficMonitor::active)
+  {
+    TrafficMonitor::active->published(getId(), property, strlen(value), qos, retained);
+  }
+  if (EnergyMonitor::active)
+  {
+    EnergyMonitor::active->published(getId());
+  }
+  _stats.publishes++;
+  _stats.bytesSent += strlen(value);
+}
+
+void SensorNode::traceSent(PropertyValue &slot, unsigned long sendStart)
+{
+  unsigned long now = micros();
+  if (slot.command)
+  {
+    _latency->record(LatencyTrace::STAGE_PUBLISH, now - slot.stageTime);
+    _latency->record(LatencyTrace::STAGE_COMMAND, now - slot.traceTime);
+  }
+  else
+  {
+    _latency->record(LatencyTrace::STAGE_QUEUE, sendStart - slot.stageTime);
+    _latency->record(LatencyTrace::STAGE_SAMPLE, now - slot.traceTime);
+    if ((slot.sentSequence != 0) && (slot.sequence - slot.sentSequence > 1))
+    {
+      _latency->skipped(slot.sequence - slot.sentSequence - 1);
+    }
+    slot.sentSequence = slot.sequence;
+  }
+  // Heartbeats resend the value, but they are not traced again
+  slot.traceTime = 0;
+}
+
+void SensorNode::traceActuated()
+{
+  if (_latency && (_commandTime != 0))
+  {
+    _actuatedTime = micros();
+    _latency->record(LatencyTrace::STAGE_GPIO, _actuatedTime - _commandTime);
+  }
+}
+
+void SensorNode::packetAcknowledged(uint16_t packetId)
+{
+  unsigned long now = micros();
+  for (SensorNode *node = _first; node; node = node->_next)
+  {
+    if (node->_latency && node->_latency->acknowledged(packetId, now))
+    {
+      return;
+    }
+  }
+}
+
+void SensorNode::publishStats()
+{
+  char age[12];
+  if (_stats.lastReadTime == 0)
+  {
+    strcpy(age, "null");
+  }
+  else
+  {
+    ultoa((NodeClock::now() - _stats.lastReadTime) / 1000UL, age, 10);
+  }
+
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer),
+           "{\"samples\":%lu,\"errors\":%lu,\"publishes\":%lu,\"bytes\":%lu,\"age\":%s,\"maxloop\":%lu}",
+           (unsigned long)_stats.samples, (unsigned long)_stats.readErrors,
+           (unsigned long)_stats.publishes, (unsigned long)_stats.bytesSent,
+           age, _stats.maxLoopTime);
+  sendProperty(cStatsTopic, buffer);
+
+  if (_latency)
+  {
+    char latency[LatencyTrace::MAX_REPORT_LENGTH];
+    _latency->format(latency, sizeof(latency), _sequence);
+    _latency->reset();
+    sendProperty(cLatencyTopic, latency);
+  }
+
+#ifdef DEBUG_HEAP
+  if (_stats.heapLosses > 0)
+  {
+    printCaption();
+    Homie.getLogger() << cIndent << _stats.heapLosses << F(" loops allocated memory") << endl;
+  }
+#endif
+
+#ifdef NODE_PROFILER
+  printCaption();
+  _profiler.print(Homie.getLogger(), cIndent);
+  _profiler.reset();
+#endif
+
+  // The longest loop is reported per stats interval
+  _stats.maxLoopTime = 0;
+  _lastStats = NodeClock::now();
+}
+
+SensorNode &SensorNode::setStatsInterval(unsigned long statsInterval)
+{
+  _statsInterval = statsInterval;
+  if ((_statsInterval > 0) && !_statsAdvertised)
+  {
+    HomieNode::advertise(cStatsTopic)
+        .setDatatype("string")
+        .setFormat("samples,errors,publishes,bytes,age[s],maxloop[us]");
+    _statsAdvertised = true;
+  }
+  return *this;
+}
+
+HomieInternals::PropertyInterface &SensorNode::advertise(const char *property)
+{
+  // The cache only grows while the properties are advertised, in the constructor or in
+  // setup(), so each node pays for the properties it actually has
+  PropertyValue *values = NULL;
+  if (_valueCount < MAX_PROPERTIES)
+  {
+    values = (PropertyValue *)realloc(_values, (_valueCount + 1) * sizeof(PropertyValue));
+  }
+  if (values)
+  {
+    _values = values;
+    PropertyValue &slot = _values[_valueCount++];
+    memset(&slot, 0, sizeof(slot));
+    slot.property = property;
+    slot.policy = DEFAULT_POLICY;
+    updateBatchSchema();
+  }
+  return HomieNode::advertise(property);
+}
+
+SensorNode::PropertyValue *SensorNode::findValue(const char *property)
+{
+  // The topics are string constants, so comparing the pointers is usually sufficient
+  for (uint8_t i = 0; i < _valueCount; i++)
+  {
+    if (_values[i].property == property || strcmp(_values[i].property, property) == 0)
+    {
+      return &_values[i];
+    }
+  }
+  return NULL;
+}
+
+SensorNode::PropertyValue *SensorNode::findValue(const char *property, size_t length)
+{
+  // For names that are not terminated, e.g. in the policy setting
+  for (uint8_t i = 0; i < _valueCount; i++)
+  {
+    if ((strncmp(_values[i].property, property, length) == 0) && (_values[i].property[length] == '\0'))
+    {
+      return &_values[i];
+    }
+  }
+  return NULL;
+}
+
+bool SensorNode::isChanged(const PropertyValue &slot)
+{
+  const PublishPolicy &policy = slot.policy;
+  if (isnan(policy.deadband) || (slot.sent[0] == '\0'))
+  {
+    return true;
+  }
+
+  char *end;
+  float value = strtod(slot.value, &end);
+  bool isNumber = (end != slot.value) && (*end == '\0');
+  float sent = strtod(slot.sent, &end);
+  isNumber = isNumber && (end != slot.sent) && (*end == '\0');
+  if (!isNumber || isnan(value) || isnan(sent))
+  {
+    return strcmp(slot.value, slot.sent) != 0;
+  }
+
+  float deadband = fabs(sent) * policy.relativeDeadband / 100.0;
+  if (deadband < policy.deadband)
+  {
+    deadband = policy.deadband;
+  }
+  return fabs(value - sent) > deadband;
+}
+
+SensorNode::PolicyResult SensorNode::checkPolicy(const PropertyValue &slot)
+{
+  const PublishPolicy &policy = slot.policy;
+  if (slot.sent[0] == '\0')
+  {
+    return POLICY_SEND;
+  }
+
+  unsigned long age = NodeClock::now() - slot.sentTime;
+  if ((policy.maxInterval > 0) && (age >= policy.maxInterval * 1000UL))
+  {
+    return POLICY_SEND; // Heartbeat
+  }
+  if (!isChanged(slot))
+  {
+    return POLICY_DROP;
+  }
+  if (age < policy.minInterval * 1000UL)
+  {
+    return POLICY_WAIT;
+  }
+  return POLICY_SEND;
+}
+
+void SensorNode::publishValue(PropertyValue &slot)
+{
+  switch (checkPolicy(slot))
+  {
+  case POLICY_SEND:
+  {
+    unsigned long sendStart = micros();
+    sendProperty(slot.property, slot.value, slot.policy.qos, slot.policy.retained);
+    if (_latency && (slot.traceTime != 0))
+    {
+      traceSent(slot, sendStart);
+    }
+    strcpy(slot.sent, slot.value);
+    slot.sentTime = NodeClock::now();
+    slot.pending = false;
+    if (RtcStore::active)
+    {
+      RtcStore::active->setValue(getId(), &slot - _values, slot.sent, slot.sentTime);
+    }
+    break;
+  }
+  case POLICY_DROP:
+    slot.pending = false;
+    slot.traceTime = 0;
+    break;
+  case POLICY_WAIT:
+    break;
+  }
+}
+
+void SensorNode::applyPolicies()
+{
+  // Sends the values that waited for their minimum interval or the publish window and the heartbeats
+  if (!canSend())
+  {
+    return;
+  }
+  if (_batchPending)
+  {
+    publishBatch();
+  }
+  if (_batchMode == BATCH_ONLY)
+  {
+    return;
+  }
+  for (uint8_t i = 0; i < _valueCount; i++)
+  {
+    PropertyValue &slot = _values[i];
+    if ((slot.value[0] != '\0') && (slot.pending || (slot.policy.maxInterval > 0)))
+    {
+      publishValue(slot);
+    }
+  }
+}
+
+SensorNode &SensorNode::setPublishPolicy(const char *property, const PublishPolicy &policy)
+{
+  PropertyValue *slot = findValue(property);
+  if (slot)
+  {
+    slot->policy = policy;
+  }
+  return *this;
+}
+
+SensorNode &SensorNode::enablePolicySetting()
+{
+  if (!_policySetting)
+  {
+    asprintf(&_policyName, "%s.publishPolicy", getId());
+    _policySetting = new HomieSetting<const char *>(_policyName, "Publish policies, e.g. \"temperature:db=0.2,min=60,max=900;status:db=0\". Default = \"\" (send every value)");
+    _policySetting->setDefaultValue("");
+  }
+  return *this;
+}
+
+void SensorNode::parsePolicy(PublishPolicy &policy, const char *params, const char *end)
+{
+  // e.g. "db=0.2,min=60,max=900,qos=0,retain=0"
+  while (params < end)
+  {
+    const char *equals = (const char *)memchr(params, '=', end - params);
+    if (!equals)
+    {
+      return;
+    }
+    size_t keyLength = equals - params;
+    char *next;
+    float value = strtod(equals + 1, &next);
+
+    if ((keyLength == 2) && (strncmp(params, "db", 2) == 0))
+    {
+      policy.deadband = value;
+    }
+    else if ((keyLength == 3) && (strncmp(params, "rdb", 3) == 0))
+    {
+      policy.relativeDeadband = value;
+      if (isnan(policy.deadband))
+      {
+        policy.deadband = 0;
+      }
+    }
+    else if ((keyLength == 3) && (strncmp(params, "min", 3) == 0))
+    {
+      policy.minInterval = (unsigned long)value;
+    }
+    else if ((keyLength == 3) && (strncmp(params, "max", 3) == 0))
+    {
+      policy.maxInterval = (unsigned long)value;
+    }
+    else if ((keyLength == 3) && (strncmp(params, "qos", 3) == 0))
+    {
+      policy.qos = (value >= 0 && value <= 2) ? (uint8_t)value : 1;
+    }
+    else if ((keyLength == 6) && (strncmp(params, "retain", 6) == 0))
+    {
+      policy.retained = (value != 0);
+    }
+
+    const char *comma = (const char *)memchr(next, ',', end - next);
+    params = comma ? comma + 1 : end;
+  }
+}
+
+void SensorNode::applyPolicySetting(const char *setting)
+{
+  // e.g. "temperature:db=0.2,max=900;status:db=0". The name "*" applies to all properties.
+  while (setting && *setting)
+  {
+    const char *end = strchr(setting, ';');
+    if (!end)
+    {
+      end = setting + strlen(setting);
+    }
+    const char *colon = (const char *)memchr(setting, ':', end - setting);
+    if (colon)
+    {
+      size_t length = colon - setting;
+      if ((length == 1) && (*setting == '*'))
+      {
+        for (uint8_t i = 0; i < _valueCount; i++)
+        {
+          parsePolicy(_values[i].policy, colon + 1, end);
+        }
+      }
+      else
+      {
+        PropertyValue *slot = findValue(setting, length);
+        if (slot)
+        {
+          parsePolicy(slot->policy, colon + 1, end);
+        }
+        else
+        {
+          printCaption();
+          Homie.getLogger() << cIndent << F("Unknown property in publish policy: ") << setting << endl;
+        }
+      }
+    }
+    setting = (*end == ';') ? end + 1 : end;
+  }
+}
+
+void SensorNode::publish(const char *property, const char *value)
+{
+  publishFormatted(property, value, NAN);
+}
+
+bool SensorNode::fitsValue(const char *property, const char *value)
+{
+  // The cache would publish a truncated and therefore wrong value. Properties
+  // without a cache slot are sent directly and may be longer, e.g. addresses.
+  if (strlen(value) < MAX_VALUE_LENGTH)
+  {
+    return true;
+  }
+  printCaption();
+  Homie.getLogger() << cIndent << F("Value for ") << property << F(" is too long: ") << value << endl;
+  return false;
+}
+
+void SensorNode::publishFormatted(const char *property, const char *value, float number)
+{
+  PropertyValue *slot = findValue(property);
+  if (slot && !fitsValue(property, value))
+  {
+    return;
+  }
+
+  if (TelemetrySink::isActive())
+  {
+    // All sinks share the formatted value, independent of the publish policy and MQTT
+    TelemetrySink::Sample sample = {NodeClock::now(), getId(), property, value, number};
+    TelemetrySink::dispatch(sample);
+  }
+
+  if (slot)
+  {
+    strncpy(slot->value, value, MAX_VALUE_LENGTH - 1);
+    slot->value[MAX_VALUE_LENGTH - 1] = '\0';
+    slot->pending = true;
+    if (_latency)
+    {
+      // A command publishes the state it switched, all other values are measurements
+      unsigned long now = micros();
+      slot->command = (_actuatedTime != 0);
+      slot->traceTime = slot->command ? _commandTime : _captureTime;
+      slot->stageTime = slot->command ? _actuatedTime : now;
+      slot->sequence = _sequence;
+      if (!slot->command && (_captureTime != 0))
+      {
+        _latency->record(LatencyTrace::STAGE_READ, now - _captureTime);
+      }
+    }
+  }
+
+  if (canSend())
+  {
+    if (!slot)
+    {
+      sendProperty(property, value);
+    }
+    else if (_batchMode != BATCH_ONLY)
+    {
+      publishValue(*slot);
+    }
+    else
+    {
+      slot->pending = false;
+    }
+  }
+}
+
+void SensorNode::publish(const char *property, const __FlashStringHelper *value)
+{
+  if (strlen_P((PGM_P)value) > MAX_VALUE_LENGTH)
+  {
+    // Too long for the cache, only a property without a cache slot can send it
+    publish(property, String(value).c_str());
+    return;
+  }
+  char buffer[MAX_VALUE_LENGTH + 1];
+  strncpy_P(buffer, (PGM_P)value, MAX_VALUE_LENGTH);
+  buffer[MAX_VALUE_LENGTH] = '\0';
+  publish(property, buffer);
+}
+
+void SensorNode::publish(const char *property, float value)
+{
+  if ((_backlog || _history) && !isnan(value))
+  {
+    PropertyValue *slot = findValue(property);
+    if (slot && _history)
+    {
+      _history->add(slot - _values, value);
+    }
+    if (slot && _backlog && !Homie.isConnected())
+    {
+      _backlog->push(slot - _values, value, NodeClock::now());
+    }
+  }
+
+  // Same format as String(float): two decimals. Values that don't fit into the
+  // cache, e.g. >= 1e8, are rejected by publishFormatted()
+  char buffer[MAX_FLOAT_LENGTH];
+  dtostrf(value, 1, 2, buffer);
+  publishFormatted(property, buffer, value);
+}
+
+void SensorNode::publish(const char *property, long value)
+{
+  char buffer[24]; // Fits a 64 bit long
+  snprintf(buffer, sizeof(buffer), "%ld", value);
+  publishFormatted(property, buffer, value);
+}
+
+void SensorNode::publish(const char *property, unsigned long value)
+{
+  char buffer[24]; // Fits a 64 bit unsigned long
+  snprintf(buffer, sizeof(buffer), "%lu", value);
+  publishFormatted(property, buffer, value);
+}
+
+bool SensorNode::isDraining()
+{
+  for (SensorNode *node = _first; node; node = node->_next)
+  {
+    if (node->_draining)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SensorNode::drainValues()
+{
+  // Sends at most one cached value per drain interval over all nodes
+  unsigned long now = NodeClock::now();
+  if (now - _lastDrain < _drainInterval)
+  {
+    return;
+  }
+  if (_drainStart == 0)
+  {
+    _drainStart = now;
+  }
+
+  if (_batchMode != BATCH_ONLY)
+  {
+    for (uint8_t i = 0; i < _valueCount; i++)
+    {
+      if (_values[i].pending)
+      {
+        uint32_t publishes = _stats.publishes;
+        publishValue(_values[i]);
+        if (_stats.publishes != publishes)
+        {
+          _lastDrain = now;
+          return;
+        }
+      }
+    }
+  }
+
+  // Values that wait for their minimum interval stay pending for applyPolicies().
+  // In batch only mode the batch below sends all values.
+  if (_batchMode == BATCH_ONLY)
+  {
+    for (uint8_t i = 0; i < _valueCount; i++)
+    {
+      _values[i].pending = false;
+    }
+  }
+  _draining = false;
+  publishBatch();
+  _lastDrain = now;
+
+  if (!isDraining())
+  {
+    Homie.getLogger() << F("• All values published ") << (now - _drainStart) << F(" ms after connecting") << endl;
+    if (_startupTime == 0)
+    {
+      _startupTime = now;
+      Homie.getLogger() << F("• Boot to fully published: ") << _startupTime << F(" ms") << endl;
+    }
+    _drainStart = 0;
+  }
+}
+
+SensorNode &SensorNode::enableBacklog(uint16_t capacity, bool spillToFlash)
+{
+  if (!_backlog)
+  {
+    if (spillToFlash)
+    {
+      asprintf(&_backlogFileName, "/%s.backlog", getId());
+    }
+    _backlog = new SampleBuffer(capacity, _backlogFileName);
+
+    HomieNode::advertise(cBacklogTopic)
+        .setDatatype("string")
+        .setFormat("property,age[s],value");
+  }
+  return *this;
+}
+
+SensorNode &SensorNode::enableHistory(const char *property)
+{
+  PropertyValue *slot = findValue(property);
+  if (!slot)
+  {
+    return *this;
+  }
+
+  if (!_history)
+  {
+    _history = new NodeHistory(getId());
+    HomieNode::advertise(cHistoryTopic)
+        .setDatatype("string")
+        .setFormat("property,tier,from,to")
+        .settable([this](const HomieRange &range, const String &value) {
+          return _history->query(value.c_str());
+        });
+  }
+  _history->addChannel(slot - _values, slot->property);
+  return *this;
+}
+
+void SensorNode::publishHistory()
+{
+  char chunk[NodeHistory::MAX_CHUNK_LENGTH];
+  if (_history && canSend() && _history->nextChunk(chunk, sizeof(chunk)))
+  {
+    sendProperty(cHistoryTopic, chunk, 1, false);
+  }
+}
+
+SensorNode &SensorNode::enableLatencyTrace()
+{
+  if (!_latency)
+  {
+    _latency = new LatencyTrace();
+    HomieNode::advertise(cLatencyTopic)
+        .setDatatype("string")
+        .setFormat("stage:p50/p90/p99/max[us],seq,skipped");
+    // The percentiles are published with the statistics
+    if (_statsInterval == 0)
+    {
+      setStatsInterval(STATS_INTERVAL);
+    }
+  }
+  return *this;
+}
+
+SensorNode &SensorNode::setBatchMode(BatchMode batchMode)
+{
+  _batchMode = batchMode;
+  if ((_batchMode != BATCH_OFF) && !_batchProperty)
+  {
+    _batchSchema = new char[MAX_SCHEMA_LENGTH];
+    _batchProperty = &HomieNode::advertise(cBatchTopic).setDatatype("string");
+    updateBatchSchema();
+  }
+  return *this;
+}
+
+void SensorNode::updateBatchSchema()
+{
+  // Properties may be advertised after the batch property, e.g. in setup().
+  // So the schema is rebuilt for each new property.
+  if (_batchProperty)
+  {
+    _batchSchema[0] = '\0';
+    for (uint8_t i = 0; i < _valueCount; i++)
+    {
+      if (i > 0)
+      {
+        strlcat(_batchSchema, ",", MAX_SCHEMA_LENGTH);
+      }
+      strlcat(_batchSchema, _values[i].property, MAX_SCHEMA_LENGTH);
+    }
+    _batchProperty->setFormat(_batchSchema);
+  }
+}
+
+void SensorNode::publishBatch()
+{
+  if (_batchMode == BATCH_OFF)
+  {
+    return;
+  }
+  if (!canSend())
+  {
+    _batchPending = Homie.isConnected();
+    return;
+  }
+  _batchPending = false;
+
+  // e.g. ["ok",21.50,45.10,1013.20,8.40]
+  char buffer[MAX_BATCH_LENGTH];
+  size_t len = 0;
+  buffer[len++] = '[';
+  for (uint8_t i = 0; i < _valueCount; i++)
+  {
+    const char *value = _values[i].value;
+    char *end;
+    float number = strtod(value, &end);
+    bool isNumber = (end != value) && (*end == '\0');
+    const char *format = "%s%s";
+
+    if ((value[0] == '\0') || (isNumber && (isnan(number) || isinf(number))))
+    {
+      value = "null";
+    }
+    else if (!isNumber && strcmp(value, "true") && strcmp(value, "false"))
+    {
+      format = "%s\"%s\"";
+    }
+    len += snprintf(buffer + len, sizeof(buffer) - len, format, (i > 0) ? "," : "", value);
+    if (len >= sizeof(buffer) - 1)
+    {
+      return;
+    }
+  }
+  buffer[len++] = ']';
+  buffer[len] = '\0';
+  sendProperty(cBatchTopic, buffer);
+}
+
+void SensorNode::replayBacklog()
+{
+  SampleBuffer::Sample sample;
+
+  if (_backlog && canSend() &&
+      (NodeClock::now() - _lastReplay >= BACKLOG_REPLAY_INTERVAL) &&
+      _backlog->pop(sample))
+  {
+    char buffer[MAX_FLOAT_LENGTH + 40];
+    char value[MAX_FLOAT_LENGTH];
+    dtostrf(sample.value, 1, 2, value);
+    snprintf(buffer, sizeof(buffer), "%s,%lu,%s",
+             _values[sample.index].property, (NodeClock::now() - sample.time) / 1000UL, value);
+    sendProperty(cBacklogTopic, buffer);
+    _lastReplay = NodeClock::now();
+  }
+}
+
+#ifdef ACQUISITION_TASK
+void SensorNode::setAcquisitionTask(AcquisitionTask *task)
+{
+  _acquisitionTask = task;
+  if (!_acquired)
+  {
+    _acquired = new SpscQueue<Acquisition, ACQUIRED_QUEUE_SIZE>();
+  }
+}
+
+void SensorNode::convert()
+{
+  // Runs in the acquisition task. Only touches the sensor and the raw values.
+  uint32_t requests = _requests.load(std::memory_order_acquire);
+  if (requests == _served)
+  {
+    return;
+  }
+  if (!_measuring)
+  {
+    start();
+  }
+  if (_measuring && ready())
+  {
+    sample();
+    _measuring = false;
+    _served = requests;
+
+    Acquisition acquisition = {micros()};
+    _acquired->push(acquisition);
+    if (TicklessIdle::active)
+    {
+      TicklessIdle::wake();
+    }
+  }
+}
+
+void SensorNode::collectAcquired()
+{
+  Acquisition acquisition;
+  while (_acquired->pop(acquisition))
+  {
+    _requestPending = false;
+    if (_latency)
+    {
+      _captureTime = acquisition.captureTime;
+    }
+    finishMeasurement();
+  }
+
+  if (_acquired->dropped() != _acquiredDropped)
+  {
+    printCaption();
+    Homie.getLogger() << cIndent << (_acquired->dropped() - _acquiredDropped) << F(" conversions dropped") << endl;
+    _acquiredDropped = _acquired->dropped();
+  }
+}
+#endif
+
+void SensorNode::loop()
+{
+  if (!_started)
+  {
+    if (RtcStore::active)
+    {
+      restoreState(*RtcStore::active);
+    }
+    _started = true;
+  }
+
+  if (!Homie.isConnected())
+  {
+    _draining = true;
+  }
+  else if (_draining)
+  {
+    drainValues();
+  }
+
+#ifdef ACQUISITION_TASK
+  if (_acquisitionTask)
+  {
+    collectAcquired();
+  }
+#endif
+  acquire();
+
+  replayBacklog();
+  publishHistory();
+  applyPolicies();
+
+  if (PublishWindow::active)
+  {
+    PublishWindow::active->update();
+  }
+
+  if ((_statsInterval > 0) && canSend() &&
+      ((NodeClock::now() - _lastStats >= _statsInterval * 1000UL) || (_lastStats == 0)))
+  {
+    publishStats();
+  }
+}
+
+void SensorNode::onReadyToOperate()
+{
+  // Not in the first loop(), which a sketch can call before Homie.setup() read the
+  // settings. They don't change until the next reboot, so applying them again after
+  // a reconnect has the same result.
+  if (_policySetting)
+  {
+    applyPolicySetting(_policySetting->get());
+  }
+  // Node specific initial values were published before this, they are pending
+  // until drainValues() sends them
+  _draining = true;
+}
+
+void SensorNode::restoreState(RtcStore &store)
+{
+  // With a deadband in the publish policy, unchanged values are not sent again after waking up
+  for (uint8_t i = 0; i < _valueCount; i++)
+  {
+    store.getValue(getId(), i, _values[i].sent, _values[i].sentTime);
+  }
+}
+
 void SensorNode::printCaption()
 {
   Homie.getLogger() << _caption << endl;
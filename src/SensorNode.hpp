@@ -9,22 +9,396 @@
 
 #pragma once
 
+// Uncomment to check the free heap before and after each loop() of a node.
+// Steady state loops must not allocate memory, a loss of free heap is logged
+// and counted in the statistics.
+// #define DEBUG_HEAP
+
 #include <Homie.hpp>
 
+#include "AcquisitionTask.hpp"
+#include "EnergyMonitor.hpp"
+#include "LatencyTrace.hpp"
+#include "NodeClock.hpp"
+#include "NodeHistory.hpp"
+#include "NodeProfiler.hpp"
+#include "NodeTrace.hpp"
+#include "PublishWindow.hpp"
+#include "RtcStore.hpp"
+#include "SampleBuffer.hpp"
+#include "SpscQueue.hpp"
+#include "TelemetrySink.hpp"
+#include "TicklessIdle.hpp"
+#include "TrafficMonitor.hpp"
+#include "constants.hpp"
+
 class SensorNode : public HomieNode
 {
+#ifdef ACQUISITION_TASK
+  friend class AcquisitionTask;
+#endif
+  friend class DiagnosticsNode;
+
+public:
+  enum BatchMode
+  {
+    BATCH_OFF,  // Publish each property separately
+    BATCH_ALSO, // Publish each property separately and all values together on "batch"
+    BATCH_ONLY  // Publish all values together on "batch" only
+  };
+
+  // Decides when a value of a property is sent. The default sends every value.
+  struct PublishPolicy
+  {
+    float deadband;            // Send only if the value changed by more than this. NAN = send every value
+    float relativeDeadband;    // Deadband in percent of the last sent value, the larger deadband applies
+    unsigned long minInterval; // Seconds between two publishes, later values wait until then
+    unsigned long maxInterval; // Resend the last value after this many seconds as heartbeat. 0 = off
+    uint8_t qos;
+    bool retained;
+  };
+  // Sends every value with QoS 1 and retained, like HomieNode does
+  static const PublishPolicy DEFAULT_POLICY;
+
 protected:
   const char *cIndent = "  ◦ ";
   const float cMinHumid = 0.0;
   const float cMaxHumid = 100.0;
   static const int MEASUREMENT_INTERVAL = 300;
+  static const int MAX_PROPERTIES = 8;    // Maximum number of properties per node that are cached
+  static const int MAX_VALUE_LENGTH = 12; // Fits a long or a float with two decimals
+  static const int MAX_FLOAT_LENGTH = 48; // Fits any float formatted with two decimals
+  static const int BACKLOG_REPLAY_INTERVAL = 100; // Publish one backlog sample every 100ms
+  static const int MAX_SCHEMA_LENGTH = MAX_PROPERTIES * 16;
+  static const int MAX_BATCH_LENGTH = MAX_PROPERTIES * (MAX_VALUE_LENGTH + 3) + 2;
+  static const int STATS_INTERVAL = 900; // Default for publishing the statistics every 15 minutes
+  static const int DRAIN_INTERVAL = 20;  // Milliseconds between two initial publishes of all nodes
+  static const int ACQUIRED_QUEUE_SIZE = 2; // Holds the one conversion that was requested
+  static const int POLL_INTERVAL = 10; // Milliseconds between two checks of a conversion or an input pin while idling
+  enum PolicyResult
+  {
+    POLICY_SEND, // Send the value now
+    POLICY_WAIT, // Keep the value pending until the minimum interval has passed
+    POLICY_DROP  // The value is within the deadband
+  };
+
+  struct NodeStats
+  {
+    uint32_t samples;           // Number of measurements taken
+    uint32_t readErrors;        // Number of failed measurements
+    uint32_t publishes;         // Number of MQTT messages sent
+    uint32_t bytesSent;         // Payload bytes sent
+    unsigned long lastReadTime; // millis() of the last successful measurement
+    unsigned long maxLoopTime;  // Longest loop() in microseconds since the last stats publish
+    uint32_t heapLosses;        // Number of loops that allocated memory (DEBUG_HEAP only)
+    int32_t heapLoop;           // Bytes allocated and not freed in loop(), without send (DiagnosticsNode only)
+    int32_t heapSend;           // Bytes allocated and not freed while sending
+  };
+
+  // Put one at the top of loop() to record its duration
+  class LoopTimer
+  {
+  private:
+    SensorNode &_node;
+    unsigned long _start;
+    uint32_t _heap = 0;
+    int32_t _heapSend = 0;
+#ifdef DEBUG_HEAP
+    uint32_t _freeHeap;
+    uint32_t _publishes;
+#endif
+
+  public:
+    explicit LoopTimer(SensorNode &node) : _node(node), _start(micros())
+    {
+      if (_trackHeap)
+      {
+        _heap = ESP.getFreeHeap();
+        _heapSend = _node._stats.heapSend;
+      }
+#ifdef DEBUG_HEAP
+      _freeHeap = ESP.getFreeHeap();
+      _publishes = _node._stats.publishes;
+#endif
+    }
+    ~LoopTimer()
+    {
+      unsigned long dt = micros() - _start;
+      if (dt > _node._stats.maxLoopTime)
+      {
+        _node._stats.maxLoopTime = dt;
+      }
+      if (EnergyMonitor::active)
+      {
+        EnergyMonitor::active->cpu(_node.getId(), dt);
+      }
+      // A reading is formatted in the loop that read it, the next loop reads anew
+      _node._captureTime = 0;
+      if (_trackHeap)
+      {
+        // What was allocated while sending is counted in sendProperty()
+        _node._stats.heapLoop += (int32_t)(_heap - ESP.getFreeHeap()) - (_node._stats.heapSend - _heapSend);
+      }
+#ifdef DEBUG_HEAP
+      // Publishing allocates in Homie and in the MQTT client, only check the other loops
+      uint32_t freeHeap = ESP.getFreeHeap();
+      if ((freeHeap < _freeHeap) && (_publishes == _node._stats.publishes))
+      {
+        _node._stats.heapLosses++;
+        _node.printCaption();
+        Homie.getLogger() << _node.cIndent << F("loop() allocated ") << (_freeHeap - freeHeap) << F(" bytes") << endl;
+      }
+#endif
+    }
+  };
+
+  // Put one at the top of handleInput() to trace the latency of a command until
+  // the new state is published
+  class CommandTrace
+  {
+  private:
+    SensorNode &_node;
+
+  public:
+    explicit CommandTrace(SensorNode &node) : _node(node)
+    {
+      _node._commandTime = _node._latency ? micros() : 0;
+    }
+    ~CommandTrace()
+    {
+      _node._commandTime = 0;
+      _node._actuatedTime = 0;
+    }
+  };
+
+  // The latest value of each advertised property. Values that can't be sent because
+  // MQTT isn't connected yet stay pending and are drained one by one after connecting.
+  struct PropertyValue
+  {
+    const char *property;
+    char value[MAX_VALUE_LENGTH];
+    bool pending;
+    PublishPolicy policy;
+    char sent[MAX_VALUE_LENGTH]; // The last value that was sent, empty = never
+    unsigned long sentTime;
+    // Latency trace of the value, only with enableLatencyTrace()
+    unsigned long traceTime; // micros() of the sensor read or the command, 0 = not traced
+    unsigned long stageTime; // micros() when the value was formatted or the output switched
+    uint32_t sequence;       // Number of the measurement
+    uint32_t sentSequence;   // Number of the last measurement that was sent
+    bool command;
+  };
 
   char *_caption{};
 
+  // All sensor nodes share one rate limit for the initial publishes after connecting
+  static SensorNode *_first;
+  static unsigned long _drainInterval;
+  static unsigned long _lastDrain;
+  static unsigned long _drainStart;
+  static unsigned long _startupTime;
+  static bool _trackHeap; // Attribute the heap changes to the nodes, set by a DiagnosticsNode
+  SensorNode *_next;
+  bool _draining = true; // The cached values haven't all been sent since connecting
+  bool _measuring = false; // A conversion has been started, but not collected yet
+  bool _alignPublishes = true; // Follow PublishWindow::active. Actors report their state immediately
+  bool _batchPending = false;
+  unsigned long _measurementInterval = MEASUREMENT_INTERVAL; // Seconds
+  unsigned long _lastMeasurement = 0;
+  unsigned long _measurementStart = 0;
+
+  // Adaptive measurement interval, off while _maxInterval is 0
+  unsigned long _minInterval = 0;
+  unsigned long _maxInterval = 0;
+  float _rateThreshold = 0;
+  float _lastValue = NAN;
+  unsigned long _lastValueTime = 0;
+
+  PropertyValue *_values = NULL; // Grows with each advertised property
+  uint8_t _valueCount = 0;
+
+  SampleBuffer *_backlog = NULL;
+  char *_backlogFileName = NULL;
+  unsigned long _lastReplay = 0;
+
+  NodeHistory *_history = NULL;
+
+  LatencyTrace *_latency = NULL;
+  uint32_t _sequence = 0;           // Counts the measurements
+  unsigned long _captureTime = 0;   // micros() of the first raw reading in this loop(), 0 = none
+  unsigned long _commandTime = 0;   // micros() when the current command arrived
+  unsigned long _actuatedTime = 0;  // micros() when the current command switched the output
+
+#ifdef ACQUISITION_TASK
+  // The acquisition task only runs start(), ready() and sample(), which may block
+  // and access the sensor. Everything else, from collect() to publishing, the
+  // statistics, the traces and the callbacks, runs in the Homie loop.
+  struct Acquisition
+  {
+    unsigned long captureTime; // micros() after sample()
+  };
+
+  AcquisitionTask *_acquisitionTask = NULL;
+  SpscQueue<Acquisition, ACQUIRED_QUEUE_SIZE> *_acquired = NULL;
+  std::atomic<uint32_t> _requests{0}; // Conversions requested by the Homie loop
+  uint32_t _served = 0;               // Conversions finished by the task, only the task uses it
+  bool _requestPending = false;       // The Homie loop waits for the requested conversion
+  uint32_t _acquiredDropped = 0;
+
+  void setAcquisitionTask(AcquisitionTask *task);
+  void convert();
+  void collectAcquired();
+#endif
+
+  BatchMode _batchMode = BATCH_OFF;
+  HomieInternals::PropertyInterface *_batchProperty = NULL;
+  char *_batchSchema = NULL;
+
+  char *_policyName = NULL;
+  HomieSetting<const char *> *_policySetting = NULL;
+  bool _started = false; // The first loop() has run
+
+  NodeStats _stats = {};
+  unsigned long _statsInterval = 0;
+  unsigned long _lastStats = 0;
+  bool _statsAdvertised = false;
+
+#ifdef NODE_PROFILER
+  NodeProfiler _profiler;
+#endif
+
   float computeAbsoluteHumidity(float temperature, float percentHumidity);
   void fixRange(float *value, float min, float max);
   virtual void printCaption();
 
+  bool isDue(unsigned long last, unsigned long interval);
+  bool isMeasurementDue();
+  unsigned long untilDue(unsigned long last, unsigned long interval);
+  unsigned long untilMeasurement();
+  static unsigned long untilElapsed(unsigned long last, unsigned long interval);
+  static unsigned long earlier(unsigned long a, unsigned long b) { return (a < b) ? a : b; }
+  bool canSend();
+  void runMeasurement(bool due);
+  void finishMeasurement();
+  void adaptInterval(float value);
+
+  float trace(uint8_t channel, float value);
+  void countSample(bool valid);
+  void sendProperty(const char *property, const char *value, uint8_t qos = 1, bool retained = true);
+  void traceSent(PropertyValue &slot, unsigned long sendStart);
+  // Call right after a command switched the output
+  void traceActuated();
+  void publishStats();
+
+  HomieInternals::PropertyInterface &advertise(const char *property);
+  PropertyValue *findValue(const char *property);
+  PropertyValue *findValue(const char *property, size_t length);
+  bool isChanged(const PropertyValue &slot);
+  PolicyResult checkPolicy(const PropertyValue &slot);
+  void publishValue(PropertyValue &slot);
+  void applyPolicies();
+  void applyPolicySetting(const char *setting);
+  void parsePolicy(PublishPolicy &policy, const char *params, const char *end);
+  void publish(const char *property, const char *value);
+  void publish(const char *property, const __FlashStringHelper *value);
+  void publish(const char *property, float value);
+  void publish(const char *property, long value);
+  void publish(const char *property, unsigned long value);
+  void publishFormatted(const char *property, const char *value, float number);
+  bool fitsValue(const char *property, const char *value);
+  void drainValues();
+  static bool isDraining();
+  void replayBacklog();
+  void publishHistory();
+  void updateBatchSchema();
+  void publishBatch();
+
+  // Restores the state from before a deep sleep, called in the first loop()
+  virtual void restoreState(RtcStore &store);
+
+  // Decides when to measure and publishes, called from loop()
+  virtual void acquire() {}
+  // Milliseconds until acquire() has something to do again
+  virtual unsigned long untilAcquire() { return TicklessIdle::FOREVER; }
+  // Milliseconds until loop() has something to do again. 0 = now,
+  // TicklessIdle::FOREVER = nothing scheduled. Nodes that measure or poll add
+  // their own deadlines.
+  virtual unsigned long nextDeadline();
+  virtual void loop() override;
+  virtual void onReadyToOperate() override;
+
 public:
   explicit SensorNode(const char *id, const char *name, const char *type);
+
+  // Split-phase acquisition:
+  // start()   triggers a conversion and returns without waiting for the result.
+  // ready()   returns true as soon as the result of the conversion can be read.
+  // sample()  reads the raw result from the sensor and nothing else.
+  // collect() processes the raw result and publishes it.
+  // Each node drives these from its own loop(). A coordinator can call start() on
+  // several nodes at once, then all conversions run in parallel instead of one
+  // after another. With an AcquisitionTask, start(), ready() and sample() run in
+  // the task and collect() in the next loop().
+  virtual void start() { _measuring = true; }
+  virtual bool ready() { return true; }
+  virtual void sample() {}
+  virtual void collect() {}
+  bool isMeasuring() const;
+
+  // Keep up to <capacity> numeric values that were measured while MQTT was not connected
+  // and replay them on the "backlog" property after reconnecting.
+  // Must be called before Homie.setup()
+  SensorNode &enableBacklog(uint16_t capacity, bool spillToFlash = false);
+
+  // Keep the history of a float property in LittleFS. Can be called for several
+  // properties, after they were advertised and before Homie.setup().
+  // LittleFS must be mounted by the firmware.
+  SensorNode &enableHistory(const char *property);
+
+  // Measure the latency of each measurement from the sensor read to the publish, and
+  // of each command from handleInput() to publishing the new state. The percentiles
+  // of each stage are published on "latency" with the statistics, which are turned on
+  // if they are off.
+  // Must be called before Homie.setup()
+  SensorNode &enableLatencyTrace();
+
+  // Publish all values of a measurement in one message on the "batch" property.
+  // The payload is a JSON array, the order of the values is advertised in $format.
+  // Must be called before Homie.setup()
+  SensorNode &setBatchMode(BatchMode batchMode);
+
+  // Adapt the measurement interval to the signal: when a value changes faster than
+  // <threshold> units per minute, measure every <minInterval> seconds. While it is
+  // stable, double the interval after each measurement up to <maxInterval> seconds.
+  // The current interval is published on "interval".
+  // Must be called before Homie.setup()
+  SensorNode &setAdaptiveInterval(unsigned long minInterval, unsigned long maxInterval, float threshold);
+
+  // Set the publish policy of an advertised property. Entries in the "<id>.publishPolicy"
+  // setting override the policies that are set here.
+  SensorNode &setPublishPolicy(const char *property, const PublishPolicy &policy);
+
+  // Read the publish policies from the "<id>.publishPolicy" setting.
+  // Must be called before Homie.setup()
+  SensorNode &enablePolicySetting();
+
+  // Interval in seconds for publishing the node statistics on "stats". 0 = off (default)
+  // Must be called before Homie.setup() to turn them on
+  SensorNode &setStatsInterval(unsigned long statsInterval = STATS_INTERVAL);
+  const NodeStats &getStats() const { return _stats; }
+
+  // Milliseconds between two initial publishes after connecting, shared by all nodes.
+  // Sending all cached values at once can overflow the outbound queue of the MQTT client.
+  static void setDrainInterval(unsigned long drainInterval) { _drainInterval = drainInterval; }
+  // Milliseconds from boot until all initial values were published. 0 = not yet
+  static unsigned long getStartupTime() { return _startupTime; }
+  // Milliseconds until the first sensor node needs its loop() again
+  static unsigned long nextWakeup();
+  // Runs the loop() of all sensor nodes on <clock> for <duration> milliseconds. The
+  // clock jumps from one deadline to the next, so a day takes a few thousand loops.
+  // Call after Homie.setup(). Returns the number of rounds over all nodes.
+  static uint32_t simulate(VirtualClock &clock, unsigned long duration);
+  // Call with the packet id of HomieEventType::MQTT_PACKET_ACKNOWLEDGED to
+  // measure the time until the broker acknowledged a traced publish
+  static void packetAcknowledged(uint16_t packetId);
 };
@@ -0,0 +1,56 @@
+/*
+ * SpscQueue.hpp
+ * Lock free queue for exactly one producer and one consumer, e.g. two tasks
+ * on different cores.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Holds up to Size - 1 items
+template <typename T, uint8_t Size>
+class SpscQueue
+{
+private:
+  T _items[Size];
+  std::atomic<uint8_t> _head{0}; // Next item to pop, only written by the consumer
+  std::atomic<uint8_t> _tail{0}; // Next free slot, only written by the producer
+  std::atomic<uint32_t> _dropped{0};
+
+public:
+  // Producer side. Returns false and drops the item if the queue is full
+  bool push(const T &item)
+  {
+    uint8_t tail = _tail.load(std::memory_order_relaxed);
+    uint8_t next = (tail + 1) % Size;
+    if (next == _head.load(std::memory_order_acquire))
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    _items[tail] = item;
+    _tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T &item)
+  {
+    uint8_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    item = _items[head];
+    _head.store((head + 1) % Size, std::memory_order_release);
+    return true;
+  }
+
+  bool isEmpty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+};
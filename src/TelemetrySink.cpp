@@ -0,0 +1,163 @@
+/*
+ * TelemetrySink.cpp
+ * Receives every value the sensor nodes publish, independent of MQTT, e.g.
+ * to log locally at a higher rate than MQTT can carry.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "TelemetrySink.hpp"
+
+TelemetrySink *TelemetrySink::_first = NULL;
+
+// Formats a sample in line protocol. Text values are quoted.
+static int formatLine(char *buffer, size_t size, const TelemetrySink::Sample &sample)
+{
+  return snprintf(buffer, size, isnan(sample.value) ? "%s %s=\"%s\" %lu" : "%s %s=%s %lu",
+                  sample.node, sample.property, sample.text, sample.time);
+}
+
+void TelemetrySink::add(TelemetrySink &sink)
+{
+  sink._next = _first;
+  _first = &sink;
+}
+
+void TelemetrySink::dispatch(const Sample &sample)
+{
+  for (TelemetrySink *sink = _first; sink; sink = sink->_next)
+  {
+    if (sink->accept(sample))
+    {
+      sink->write(sample);
+    }
+  }
+}
+
+bool TelemetrySink::accept(const Sample &sample)
+{
+  if (_interval == 0)
+  {
+    return true;
+  }
+
+  // The topics are string constants, so comparing the pointers is sufficient
+  for (uint8_t i = 0; i < _channelCount; i++)
+  {
+    Channel &channel = _channels[i];
+    if ((channel.node == sample.node) && (channel.property == sample.property))
+    {
+      if (sample.time - channel.lastWrite < _interval)
+      {
+        return false;
+      }
+      channel.lastWrite = sample.time;
+      return true;
+    }
+  }
+  if (_channelCount < MAX_CHANNELS)
+  {
+    _channels[_channelCount++] = {sample.node, sample.property, sample.time};
+  }
+  return true;
+}
+
+LineProtocolSink::LineProtocolSink(Print &out, unsigned long interval)
+    : TelemetrySink(interval),
+      _out(out)
+{
+}
+
+void LineProtocolSink::write(const Sample &sample)
+{
+  char line[80];
+  formatLine(line, sizeof(line), sample);
+  _out.println(line);
+}
+
+CsvSink::CsvSink(const char *fileName, unsigned long interval, uint32_t maxSize)
+    : TelemetrySink(interval),
+      _fileName(fileName),
+      _maxSize(maxSize)
+{
+  snprintf(_oldFileName, sizeof(_oldFileName), "%s.old", fileName);
+}
+
+CsvSink::~CsvSink()
+{
+  close();
+}
+
+bool CsvSink::openFile(unsigned long now)
+{
+  if (!_file)
+  {
+    // Opened on the first sample, because the firmware mounts LittleFS after the constructor
+    _file = LittleFS.open(_fileName, "a");
+    _size = _file ? _file.size() : 0;
+    _lastFlush = now;
+  }
+  return _file;
+}
+
+void CsvSink::close()
+{
+  if (_file)
+  {
+    _file.close();
+  }
+}
+
+void CsvSink::write(const Sample &sample)
+{
+  char line[80];
+  int length = snprintf(line, sizeof(line), "%lu,%s,%s,%s\n", sample.time, sample.node, sample.property, sample.text);
+  if ((length <= 0) || (length >= (int)sizeof(line)) || !openFile(sample.time))
+  {
+    return;
+  }
+
+  if (_size + length > _maxSize)
+  {
+    _file.close();
+    LittleFS.remove(_oldFileName);
+    LittleFS.rename(_fileName, _oldFileName);
+    if (!openFile(sample.time))
+    {
+      return;
+    }
+  }
+  _size += _file.write((const uint8_t *)line, length);
+
+  // LittleFS only writes full blocks, a flush per line would wear the flash
+  if (sample.time - _lastFlush >= FLUSH_INTERVAL)
+  {
+    _file.flush();
+    _lastFlush = sample.time;
+  }
+}
+
+UdpSink::UdpSink(const char *host, uint16_t port, unsigned long interval)
+    : TelemetrySink(interval),
+      _port(port)
+{
+  _host.fromString(host);
+}
+
+void UdpSink::write(const Sample &sample)
+{
+  char line[80];
+  int length = formatLine(line, sizeof(line), sample);
+  if ((length <= 0) || (length >= (int)sizeof(line)))
+  {
+    return;
+  }
+
+  // Sending fails silently while WiFi is not connected
+  if (_udp.beginPacket(_host, _port))
+  {
+    _udp.write((const uint8_t *)line, length);
+    _udp.endPacket();
+  }
+}
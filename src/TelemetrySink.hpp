@@ -0,0 +1,118 @@
+/*
+ * TelemetrySink.hpp
+ * Receives every value the sensor nodes publish, independent of MQTT, e.g.
+ * to log locally at a higher rate than MQTT can carry.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include <LittleFS.h>
+#include <WiFiUdp.h>
+
+class TelemetrySink
+{
+public:
+  // Passed by reference to all sinks, the text is formatted once by the node
+  struct Sample
+  {
+    unsigned long time; // NodeClock milliseconds
+    const char *node;
+    const char *property;
+    const char *text;   // The value as it is published
+    float value;        // NAN if the value is not a number
+  };
+
+private:
+  static const int MAX_CHANNELS = 32;
+
+  struct Channel
+  {
+    const char *node;
+    const char *property;
+    unsigned long lastWrite;
+  };
+
+  static TelemetrySink *_first;
+  TelemetrySink *_next = NULL;
+  unsigned long _interval;
+  Channel _channels[MAX_CHANNELS];
+  uint8_t _channelCount = 0;
+
+  bool accept(const Sample &sample);
+
+protected:
+  virtual void write(const Sample &sample) = 0;
+
+public:
+  // Each sink writes a property at most once per <interval> ms. 0 = every value
+  explicit TelemetrySink(unsigned long interval = 0) : _interval(interval) {}
+  virtual ~TelemetrySink() {}
+
+  // Adds a sink to the sinks all nodes write to
+  static void add(TelemetrySink &sink);
+  static bool isActive() { return _first != NULL; }
+  static void dispatch(const Sample &sample);
+};
+
+// InfluxDB line protocol, e.g. "bme280 temperature=21.50 123456"
+class LineProtocolSink : public TelemetrySink
+{
+private:
+  Print &_out;
+
+protected:
+  virtual void write(const Sample &sample) override;
+
+public:
+  explicit LineProtocolSink(Print &out, unsigned long interval = 0);
+};
+
+// Appends "time,node,property,value" lines to a file in LittleFS.
+// LittleFS must be mounted by the firmware.
+class CsvSink : public TelemetrySink
+{
+private:
+  static const unsigned long FLUSH_INTERVAL = 10000; // Milliseconds between two flushes of the open file
+
+  const char *_fileName;
+  uint32_t _maxSize;
+  char _oldFileName[32];
+  File _file; // Stays open between the samples, it is only reopened to rotate it
+  uint32_t _size = 0;
+  unsigned long _lastFlush = 0;
+
+  bool openFile(unsigned long now);
+
+protected:
+  virtual void write(const Sample &sample) override;
+
+public:
+  // When the file reaches <maxSize> bytes it is renamed to <fileName>.old
+  CsvSink(const char *fileName, unsigned long interval = 0, uint32_t maxSize = 64 * 1024);
+  virtual ~CsvSink();
+
+  // Writes the buffered lines and closes the file, e.g. before deep sleep or unmounting
+  // LittleFS. The next sample opens it again.
+  void close();
+};
+
+// Sends each value in line protocol as one UDP datagram
+class UdpSink : public TelemetrySink
+{
+private:
+  WiFiUDP _udp;
+  IPAddress _host;
+  uint16_t _port;
+
+protected:
+  virtual void write(const Sample &sample) override;
+
+public:
+  // <host> is an IPv4 address, e.g. "192.168.0.10"
+  UdpSink(const char *host, uint16_t port, unsigned long interval = 0);
+};
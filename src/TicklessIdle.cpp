@@ -0,0 +1,94 @@
+/*
+ * TicklessIdle.cpp
+ * Lets the main loop sleep until the earliest deadline of all sensor nodes,
+ * a pin interrupt or wake() instead of spinning through all loop()s.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "TicklessIdle.hpp"
+#include "SensorNode.hpp"
+
+TicklessIdle *TicklessIdle::active = NULL;
+volatile bool TicklessIdle::_woken = false;
+#ifdef ESP32
+TaskHandle_t TicklessIdle::_task = NULL;
+#endif
+
+TicklessIdle::TicklessIdle(unsigned long maxSleep)
+    : _maxSleep(maxSleep)
+{
+}
+
+void IRAM_ATTR TicklessIdle::wake()
+{
+  _woken = true;
+#ifdef ESP32
+  if (_task)
+  {
+    if (xPortInIsrContext())
+    {
+      BaseType_t higherPriorityTaskWoken = pdFALSE;
+      vTaskNotifyGiveFromISR(_task, &higherPriorityTaskWoken);
+      portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+    else
+    {
+      xTaskNotifyGive(_task);
+    }
+  }
+#endif
+}
+
+bool TicklessIdle::wakeOn(uint8_t pin)
+{
+  int interrupt = digitalPinToInterrupt(pin);
+  if (interrupt == NOT_AN_INTERRUPT)
+  {
+    return false;
+  }
+  attachInterrupt(interrupt, wake, CHANGE);
+  return true;
+}
+
+void TicklessIdle::idle()
+{
+  unsigned long sleep = SensorNode::nextWakeup();
+  if (sleep > _maxSleep)
+  {
+    sleep = _maxSleep;
+  }
+  if (_woken || (sleep < MIN_SLEEP))
+  {
+    _woken = false;
+    return;
+  }
+
+  // Sleeps in real time, also when a VirtualClock drives the nodes
+  unsigned long start = millis();
+#ifdef ESP32
+  // The idle task runs meanwhile, with automatic light sleep if it is enabled
+  // in the power management of ESP-IDF
+  if (!_task)
+  {
+    _task = xTaskGetCurrentTaskHandle();
+  }
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep));
+#else
+  // The ESP8266 enters modem or light sleep during delay(), depending on WiFi.setSleepMode()
+  unsigned long elapsed = 0;
+  while (!_woken && (elapsed < sleep))
+  {
+    delay((sleep - elapsed < SLICE) ? sleep - elapsed : SLICE);
+    elapsed = millis() - start;
+  }
+#endif
+  if (_woken)
+  {
+    _wakeups++;
+    _woken = false;
+  }
+  _sleeps++;
+  _idleTime += millis() - start;
+}
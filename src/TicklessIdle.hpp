@@ -0,0 +1,54 @@
+/*
+ * TicklessIdle.hpp
+ * Lets the main loop sleep until the earliest deadline of all sensor nodes,
+ * a pin interrupt or wake() instead of spinning through all loop()s.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class TicklessIdle
+{
+public:
+  // A node that has nothing scheduled returns this from nextDeadline()
+  static const unsigned long FOREVER = 0xFFFFFFFFUL;
+
+private:
+  static const unsigned long MIN_SLEEP = 2; // Shorter idle times are not worth it
+  static const unsigned long SLICE = 10;    // Without task notifications, check for wake() every 10ms
+
+  unsigned long _maxSleep;
+  uint32_t _sleeps = 0;
+  uint32_t _wakeups = 0;
+  uint32_t _idleTime = 0;
+
+  static volatile bool _woken;
+#ifdef ESP32
+  static TaskHandle_t _task;
+#endif
+
+public:
+  // The idle layer all nodes use. NULL = the loop spins as before
+  static TicklessIdle *active;
+
+  // Sleeps at most <maxSleep> ms at a time. Homie handles incoming MQTT messages
+  // and reconnects only in Homie.loop(), so this bounds their latency.
+  explicit TicklessIdle(unsigned long maxSleep = 100);
+
+  // Call at the end of the sketch's loop(), after Homie.loop()
+  void idle();
+  // Ends the current idle() early. Can be called from an ISR or another task.
+  static void IRAM_ATTR wake();
+  // Wakes up on each change of <pin>. Returns false if the pin has no interrupt.
+  bool wakeOn(uint8_t pin);
+
+  uint32_t getSleeps() const { return _sleeps; }
+  // Number of sleeps that were ended early by wake()
+  uint32_t getWakeups() const { return _wakeups; }
+  // Milliseconds spent in idle() since boot
+  uint32_t getIdleTime() const { return _idleTime; }
+};
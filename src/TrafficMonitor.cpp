@@ -0,0 +1,129 @@
+/*
+ * TrafficMonitor.cpp
+ * Accounts the MQTT messages and bytes published by each node and reports
+ * them per hour.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#include "TrafficMonitor.hpp"
+#include "NodeClock.hpp"
+
+TrafficMonitor *TrafficMonitor::active = NULL;
+
+TrafficMonitor::TrafficMonitor(Print *log)
+    : _log(log),
+      _start(NodeClock::now())
+{
+}
+
+size_t TrafficMonitor::topicPrefixLength()
+{
+  // <baseTopic><deviceId>/
+  return strlen(Homie.getConfiguration().mqtt.baseTopic) + strlen(Homie.getConfiguration().deviceId) + 1;
+}
+
+TrafficMonitor::Entry *TrafficMonitor::findEntry(const char *node, const char *property)
+{
+  for (uint8_t i = 0; i < _entryCount; i++)
+  {
+    if ((_entries[i].node == node) && ((_entries[i].property == property) || !strcmp(_entries[i].property, property)))
+    {
+      return &_entries[i];
+    }
+  }
+  if (_entryCount < MAX_ENTRIES)
+  {
+    _entries[_entryCount] = {node, property, 0, 0};
+    return &_entries[_entryCount++];
+  }
+  return NULL;
+}
+
+void TrafficMonitor::published(const char *node, const char *property, size_t payloadLength, uint8_t qos, bool retained)
+{
+  // <prefix><node>/<property>
+  size_t topicLength = topicPrefixLength() + strlen(node) + 1 + strlen(property);
+
+  Entry *entry = findEntry(node, property);
+  if (entry)
+  {
+    entry->messages++;
+    entry->bytes += topicLength + payloadLength;
+  }
+  else
+  {
+    _untracked++;
+  }
+
+  if (_log)
+  {
+    _log->printf("%lu %s/%s %u+%u q%u%s\n", NodeClock::now() - _start, node, property,
+                 (unsigned int)topicLength, (unsigned int)payloadLength, qos, retained ? " r" : "");
+  }
+}
+
+void TrafficMonitor::report(Print &out)
+{
+  unsigned long elapsed = NodeClock::now() - _start;
+  if (elapsed == 0)
+  {
+    elapsed = 1;
+  }
+
+  out.printf("Traffic over %lus:\n", elapsed / 1000UL);
+  out.printf("%-12s %-14s %8s %10s %8s %10s\n", "node", "property", "msgs", "bytes", "msgs/h", "bytes/h");
+
+  for (uint8_t i = 0; i < _entryCount; i++)
+  {
+    const char *node = _entries[i].node;
+    bool first = true;
+    uint32_t messages = 0;
+    uint32_t bytes = 0;
+
+    // Print each node once, with its properties and a total
+    for (uint8_t j = 0; j < i; j++)
+    {
+      if (_entries[j].node == node)
+      {
+        first = false;
+        break;
+      }
+    }
+    if (!first)
+    {
+      continue;
+    }
+
+    for (uint8_t j = i; j < _entryCount; j++)
+    {
+      if (_entries[j].node == node)
+      {
+        const Entry &entry = _entries[j];
+        out.printf("%-12s %-14s %8lu %10lu %8lu %10lu\n", node, entry.property,
+                   (unsigned long)entry.messages, (unsigned long)entry.bytes,
+                   (unsigned long)((uint64_t)entry.messages * 3600000UL / elapsed),
+                   (unsigned long)((uint64_t)entry.bytes * 3600000UL / elapsed));
+        messages += entry.messages;
+        bytes += entry.bytes;
+      }
+    }
+    out.printf("%-12s %-14s %8lu %10lu %8lu %10lu\n", node, "total",
+               (unsigned long)messages, (unsigned long)bytes,
+               (unsigned long)((uint64_t)messages * 3600000UL / elapsed),
+               (unsigned long)((uint64_t)bytes * 3600000UL / elapsed));
+  }
+
+  if (_untracked > 0)
+  {
+    out.printf("%lu messages not accounted, increase MAX_ENTRIES\n", (unsigned long)_untracked);
+  }
+}
+
+void TrafficMonitor::reset()
+{
+  _entryCount = 0;
+  _untracked = 0;
+  _start = NodeClock::now();
+}
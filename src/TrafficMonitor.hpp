@@ -0,0 +1,46 @@
+/*
+ * TrafficMonitor.hpp
+ * Accounts the MQTT messages and bytes published by each node and reports
+ * them per hour.
+ *
+ * Version: 1.0
+ * Author: Lübbe Onken (http://github.com/luebbe)
+ */
+
+#pragma once
+
+#include <Homie.hpp>
+
+class TrafficMonitor
+{
+private:
+  static const int MAX_ENTRIES = 48;
+
+  struct Entry
+  {
+    const char *node;
+    const char *property;
+    uint32_t messages;
+    uint32_t bytes; // Topic and payload
+  };
+
+  Print *_log;
+  unsigned long _start;
+  Entry _entries[MAX_ENTRIES];
+  uint8_t _entryCount = 0;
+  uint32_t _untracked = 0;
+
+  size_t topicPrefixLength();
+  Entry *findEntry(const char *node, const char *property);
+
+public:
+  // The monitor all nodes report to. NULL = accounting is off
+  static TrafficMonitor *active;
+
+  // If log is given, each publish is written to it as one line
+  explicit TrafficMonitor(Print *log = NULL);
+
+  void published(const char *node, const char *property, size_t payloadLength, uint8_t qos, bool retained);
+  void report(Print &out);
+  void reset();
+};
@@ -23,3 +23,23 @@
 #define cPingTopic "ping"
 #define cChangedTopic "changed"
 #define cValidTopic "valid"
+#define cActiveTopic "active"
+#define cPulsesTopic "pulses"
+#define cTotalTopic "total"
+#define cDownTopic "down"
+#define cDurationTopic "duration"
+#define cOpenTopic "open"
+#define cOnTopic "on"
+#define cTimeoutTopic "timeout"
+#define cBacklogTopic "backlog"
+#define cBatchTopic "batch"
+#define cStatsTopic "stats"
+#define cIntervalTopic "interval"
+#define cHistoryTopic "history"
+#define cLatencyTopic "latency"
+#define cFreeHeapTopic "freeheap"
+#define cMaxBlockTopic "maxblock"
+#define cFragmentationTopic "fragmentation"
+#define cFreeStackTopic "freestack"
+#define cHeapTrendTopic "heaptrend"
+#define cHeapNodesTopic "heapnodes"